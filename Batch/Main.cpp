@@ -0,0 +1,460 @@
+/*
+  ==============================================================================
+
+	SoundWizard batch renderer.
+
+	Runs the plugin's processor without a host or an editor over any number of
+	files. Each worker thread owns one processor and takes the next file from a
+	shared list, so files render in parallel without sharing any DSP state.
+	Every file is streamed through StreamingRender, so memory use does not
+	depend on its length.
+
+	SoundWizardBatch [options] <input files...>
+
+		--output <dir>          where the rendered files go, required
+		--state <file>          settings saved from the plugin, as binary state or XML
+		--set <id>=<value>      a parameter by ID in its own units, may be repeated
+		--format wav|flac|aiff  output format, the input's own by default
+		--threads <n>           worker threads, one per core by default
+		--block <samples>       block size the processor runs at, 16384 by default
+		--parallel-chunks       one file at a time, each cut into chunks of --block that
+		                        are filtered on every thread at once, IIR without oversampling only
+
+	Each output keeps its input's name. Inputs that would render to the same file,
+	or onto one of the inputs, stop the run before anything is written.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../Source/PluginProcessor.h"
+#include "StreamingRender.h"
+#include "ParallelCascade.h"
+
+#include <iostream>
+
+namespace
+{
+	struct BatchSettings
+	{
+		juce::File outputDirectory;
+		juce::MemoryBlock state;
+		juce::String format;
+		int numThreads = 0;
+		int blockSize = 16384;
+		bool parallelChunks = false;
+	};
+
+	struct RenderTotals
+	{
+		double audioSeconds = 0.0;
+		double busySeconds = 0.0;
+		int numRendered = 0;
+		int numFailed = 0;
+	};
+
+	//Workers report from their own threads, one line at a time
+	void log(const juce::String& message)
+	{
+		static juce::CriticalSection lock;
+		const juce::ScopedLock sl(lock);
+
+		std::cout << message << std::endl;
+	}
+
+	juce::String getOption(const juce::ArgumentList& args, const char* option)
+	{
+		return args.containsOption(option) ? args.getValueForOption(option) : juce::String();
+	}
+
+	juce::File getOutputFile(const BatchSettings& settings, const juce::File& input)
+	{
+		auto extension = settings.format.isNotEmpty() ? "." + settings.format : input.getFileExtension();
+		return settings.outputDirectory.getChildFile(input.getFileNameWithoutExtension() + extension);
+	}
+
+	//The workers write at the same time, so no two inputs may share an output and no output may replace an input
+	bool checkOutputFiles(const juce::Array<juce::File>& inputs, const juce::Array<juce::File>& outputs)
+	{
+		auto valid = true;
+
+		for (int i = 0; i < outputs.size(); ++i)
+		{
+			if (inputs.contains(outputs[i]))
+			{
+				log(inputs[i].getFullPathName() + ": would overwrite the input " + outputs[i].getFullPathName());
+				valid = false;
+			}
+
+			for (int j = 0; j < i; ++j)
+			{
+				if (outputs[j] == outputs[i])
+				{
+					log(inputs[j].getFullPathName() + " and " + inputs[i].getFullPathName() + " would both render to "
+						+ outputs[i].getFullPathName());
+					valid = false;
+					break;
+				}
+			}
+		}
+
+		return valid;
+	}
+
+	class RenderWorker : public juce::Thread
+	{
+	public:
+		RenderWorker(const BatchSettings& batchSettings, const juce::Array<juce::File>& inputFiles,
+			const juce::Array<juce::File>& outputFiles, std::atomic<int>& next)
+			: juce::Thread("SoundWizard Render"), settings(batchSettings), files(inputFiles), outputs(outputFiles), nextFile(next)
+		{
+			formats.registerBasicFormats();
+
+			//Set up on the main thread, the worker only renders
+			processor.setNonRealtime(true);
+			processor.setStateInformation(settings.state.getData(), (int)settings.state.getSize());
+
+			if (settings.parallelChunks)
+				parallelCascade = std::make_unique<ParallelCascade>(settings.numThreads);
+		}
+
+		const RenderTotals& getTotals() const { return totals; }
+
+		void run() override
+		{
+			for (auto index = nextFile++; index < files.size() && !threadShouldExit(); index = nextFile++)
+			{
+				const auto& input = files.getReference(index);
+				juce::String error;
+
+				auto start = juce::Time::getMillisecondCounterHiRes();
+				auto seconds = render(input, outputs.getReference(index), error);
+				//A chunk parallel file keeps every thread busy for as long as it takes
+				auto busy = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0 * (parallelCascade != nullptr ? settings.numThreads : 1);
+
+				if (error.isNotEmpty())
+				{
+					++totals.numFailed;
+					log(input.getFileName() + ": " + error);
+					continue;
+				}
+
+				++totals.numRendered;
+				totals.audioSeconds += seconds;
+				totals.busySeconds += busy;
+
+				log(input.getFileName() + ": " + juce::String(seconds, 1) + " s in " + juce::String(busy, 2) + " s, "
+					+ juce::String(seconds / juce::jmax(busy, 1.0e-6), 1) + "x realtime");
+			}
+		}
+
+	private:
+		const BatchSettings& settings;
+		const juce::Array<juce::File>& files;
+		const juce::Array<juce::File>& outputs;
+		std::atomic<int>& nextFile;
+
+		juce::AudioFormatManager formats;
+		SoundWizardAudioProcessor processor;
+		std::unique_ptr<ParallelCascade> parallelCascade;
+		RenderTotals totals;
+
+		//The sections the chain runs, in the same order
+		static std::vector<BiquadCoefficients<double>> getSections(const FilterCoefficientSet<double>& coefficients)
+		{
+			std::vector<BiquadCoefficients<double>> sections;
+
+			for (int i = 0; i <= coefficients.lowCutSlope; ++i)
+				sections.push_back(coefficients.lowCut[(size_t)i]);
+
+			sections.push_back(coefficients.peak);
+
+			for (int i = 0; i <= coefficients.highCutSlope; ++i)
+				sections.push_back(coefficients.highCut[(size_t)i]);
+
+			return sections;
+		}
+
+		//Returns the length rendered in seconds, sets error if the file could not be rendered
+		double render(const juce::File& input, const juce::File& output, juce::String& error)
+		{
+			//Mapped where the format allows it, decoded from a stream otherwise
+			std::unique_ptr<juce::MemoryMappedAudioFormatReader> mappedReader;
+			std::unique_ptr<juce::AudioFormatReader> streamReader;
+
+			if (auto* inputFormat = formats.findFormatForFileExtension(input.getFileExtension()))
+				mappedReader.reset(inputFormat->createMemoryMappedReader(input));
+
+			if (mappedReader == nullptr)
+				streamReader.reset(formats.createReaderFor(input));
+
+			auto* reader = mappedReader != nullptr ? static_cast<juce::AudioFormatReader*>(mappedReader.get()) : streamReader.get();
+
+			if (reader == nullptr)
+			{
+				error = "not a readable audio file";
+				return 0.0;
+			}
+
+			auto extension = output.getFileExtension();
+			auto* format = formats.findFormatForFileExtension(extension);
+
+			if (format == nullptr)
+			{
+				error = "no writer for " + extension;
+				return 0.0;
+			}
+
+			auto numChannels = (int)reader->numChannels;
+			auto sampleRate = reader->sampleRate;
+			auto blockSize = settings.blockSize;
+
+			auto channelSet = juce::AudioChannelSet::canonicalChannelSet(numChannels);
+
+			if (channelSet.isDisabled())
+				channelSet = juce::AudioChannelSet::discreteChannels(numChannels);
+
+			juce::AudioProcessor::BusesLayout layout;
+			layout.inputBuses.add(channelSet);
+			layout.outputBuses.add(channelSet);
+
+			//Chunks only add up exactly for the plain cascade, the oversampling and FIR paths are not covered
+			auto filterMode = (int)processor.apvts.getRawParameterValue("Filter Mode")->load();
+			auto oversampling = (int)processor.apvts.getRawParameterValue("Oversampling")->load();
+
+			if (parallelCascade != nullptr && (filterMode != FilterMode::FM_IIR || oversampling != OversamplingFactor::OS_Off))
+			{
+				error = "--parallel-chunks needs the IIR filter mode without oversampling";
+				return 0.0;
+			}
+
+			if (parallelCascade == nullptr && !processor.setBusesLayout(layout))
+			{
+				error = juce::String(numChannels) + " channels are not supported";
+				return 0.0;
+			}
+
+			//The closest depth the output format can store
+			auto bitDepths = format->getPossibleBitDepths();
+			auto bitsPerSample = bitDepths.contains((int)reader->bitsPerSample) ? (int)reader->bitsPerSample : bitDepths.getLast();
+
+			output.deleteFile();
+
+			std::unique_ptr<juce::OutputStream> stream(output.createOutputStream());
+			std::unique_ptr<juce::AudioFormatWriter> writer;
+
+			if (stream != nullptr)
+				writer.reset(format->createWriterFor(stream.get(), sampleRate, (unsigned int)numChannels, bitsPerSample, reader->metadataValues, 0));
+
+			if (writer == nullptr)
+			{
+				error = "could not write " + output.getFullPathName();
+				return 0.0;
+			}
+
+			//The writer owns the stream now
+			stream.release();
+
+			juce::MidiBuffer midi;
+			std::function<void(juce::AudioBuffer<float>&)> processBlock;
+			auto streamBlockSize = blockSize;
+			auto latency = 0;
+
+			if (parallelCascade != nullptr)
+			{
+				FilterCoefficientSet<double> coefficients;
+				makeFilterCoefficients(coefficients, getChainSettings(processor.apvts), sampleRate);
+
+				//One chunk per thread in every streamed block
+				parallelCascade->prepare(getSections(coefficients), numChannels, blockSize);
+				streamBlockSize = blockSize * settings.numThreads;
+
+				processBlock = [this](juce::AudioBuffer<float>& block) { parallelCascade->process(block); };
+			}
+			else
+			{
+				processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+				processor.prepareToPlay(sampleRate, blockSize);
+				latency = processor.getLatencySamples();
+
+				processBlock = [this, &midi](juce::AudioBuffer<float>& block) { processor.processBlock(block, midi); };
+			}
+
+			StreamingRender streamingRender(processBlock, *reader, mappedReader.get(), *writer, streamBlockSize, latency);
+			auto succeeded = streamingRender.run();
+
+			if (parallelCascade == nullptr)
+				processor.releaseResources();
+
+			if (!succeeded)
+			{
+				error = "reading or writing failed";
+				return 0.0;
+			}
+
+			return (double)reader->lengthInSamples / sampleRate;
+		}
+	};
+
+	//Settings from --state first, then every --set on top of them
+	bool loadSettings(const juce::ArgumentList& args, juce::MemoryBlock& state)
+	{
+		SoundWizardAudioProcessor processor;
+
+		auto stateFile = getOption(args, "--state");
+
+		if (stateFile.isNotEmpty())
+		{
+			juce::MemoryBlock data;
+
+			if (!juce::File::getCurrentWorkingDirectory().getChildFile(stateFile).loadFileAsData(data))
+			{
+				log("Could not read " + stateFile);
+				return false;
+			}
+
+			//XML is turned into the binary state, so the channel links are restored the same way
+			if (auto xml = juce::parseXML(data.toString()))
+			{
+				data.reset();
+				juce::MemoryOutputStream mos(data, false);
+				juce::ValueTree::fromXml(*xml).writeToStream(mos);
+			}
+
+			processor.setStateInformation(data.getData(), (int)data.getSize());
+		}
+
+		for (int i = 0; i < args.size(); ++i)
+		{
+			juce::String assignment;
+
+			if (args[i].text.startsWith("--set="))
+				assignment = args[i].text.fromFirstOccurrenceOf("=", false, false);
+			else if (args[i] == "--set" && i + 1 < args.size())
+				assignment = args[++i].text;
+			else
+				continue;
+			auto id = assignment.upToFirstOccurrenceOf("=", false, false).trim();
+			auto value = assignment.fromFirstOccurrenceOf("=", false, false).trim();
+
+			auto* parameter = dynamic_cast<juce::RangedAudioParameter*>(processor.apvts.getParameter(id));
+
+			if (parameter == nullptr)
+			{
+				log("Unknown parameter " + id);
+				return false;
+			}
+
+			parameter->setValueNotifyingHost(parameter->convertTo0to1(value.getFloatValue()));
+		}
+
+		processor.getStateInformation(state);
+		return true;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	juce::ScopedJuceInitialiser_GUI juceInitialiser;
+	juce::ArgumentList args(argc, argv);
+
+	BatchSettings settings;
+
+	auto outputPath = getOption(args, "--output");
+
+	if (outputPath.isEmpty())
+	{
+		log("Usage: SoundWizardBatch --output <dir> [--state <file>] [--set <id>=<value>]... "
+			"[--format wav|flac|aiff] [--threads <n>] [--block <samples>] <input files...>");
+		return 1;
+	}
+
+	settings.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(outputPath);
+	settings.format = getOption(args, "--format").toLowerCase();
+	settings.numThreads = getOption(args, "--threads").getIntValue();
+
+	auto blockSize = getOption(args, "--block").getIntValue();
+	settings.blockSize = blockSize > 0 ? juce::jmax(32, blockSize) : 16384;
+
+	if (settings.numThreads <= 0)
+		settings.numThreads = juce::SystemStats::getNumCpus();
+
+	settings.parallelChunks = args.containsOption("--parallel-chunks");
+
+	if (!settings.outputDirectory.createDirectory())
+	{
+		log("Could not create " + settings.outputDirectory.getFullPathName());
+		return 1;
+	}
+
+	if (!loadSettings(args, settings.state))
+		return 1;
+
+	//Whatever is left after the options and their values are the inputs
+	juce::Array<juce::File> files;
+
+	for (int i = 0; i < args.size(); ++i)
+	{
+		if (args[i].isOption())
+		{
+			//Every option but the flag is followed by its value
+			if (!args[i].text.containsChar('=') && args[i] != "--parallel-chunks")
+				++i;
+
+			continue;
+		}
+
+		files.add(args[i].resolveAsFile());
+	}
+
+	if (files.isEmpty())
+	{
+		log("No input files");
+		return 1;
+	}
+
+	juce::Array<juce::File> outputs;
+
+	for (const auto& input : files)
+		outputs.add(getOutputFile(settings, input));
+
+	if (!checkOutputFiles(files, outputs))
+		return 1;
+
+	std::atomic<int> nextFile{ 0 };
+	juce::OwnedArray<RenderWorker> workers;
+
+	//Chunk parallel files already use every thread, so they go one at a time
+	auto numWorkers = settings.parallelChunks ? 1 : juce::jmin(settings.numThreads, files.size());
+
+	for (int i = 0; i < numWorkers; ++i)
+		workers.add(new RenderWorker(settings, files, outputs, nextFile));
+
+	auto start = juce::Time::getMillisecondCounterHiRes();
+
+	for (auto* worker : workers)
+		worker->startThread();
+
+	for (auto* worker : workers)
+		worker->waitForThreadToExit(-1);
+
+	auto wallSeconds = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0;
+
+	RenderTotals totals;
+
+	for (auto* worker : workers)
+	{
+		totals.audioSeconds += worker->getTotals().audioSeconds;
+		totals.busySeconds += worker->getTotals().busySeconds;
+		totals.numRendered += worker->getTotals().numRendered;
+		totals.numFailed += worker->getTotals().numFailed;
+	}
+
+	//Per core is the audio rendered over the time the workers were busy, overall is over the wall clock
+	log(juce::String(totals.numRendered) + " rendered, " + juce::String(totals.numFailed) + " failed on "
+		+ juce::String(workers.size()) + " threads, "
+		+ juce::String(totals.audioSeconds / juce::jmax(totals.busySeconds, 1.0e-6), 1) + "x realtime per core, "
+		+ juce::String(totals.audioSeconds / juce::jmax(wallSeconds, 1.0e-6), 1) + "x overall");
+
+	return totals.numFailed == 0 ? 0 : 1;
+}
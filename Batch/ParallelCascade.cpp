@@ -0,0 +1,227 @@
+/*
+  ==============================================================================
+
+	Chunk parallel filtering of one long stream, see ParallelCascade.h.
+
+  ==============================================================================
+*/
+
+#include "ParallelCascade.h"
+
+ParallelCascade::ParallelCascade(int numThreads) : pool(juce::jmax(1, numThreads))
+{
+}
+
+void ParallelCascade::prepare(const std::vector<BiquadCoefficients<double>>& sectionsToUse, int numChannels, int chunkLengthToUse)
+{
+	sections = sectionsToUse;
+	numStates = (int)sections.size() * 2;
+	chunkLength = chunkLengthToUse;
+
+	//Every unit state run with no input until it has rung out or the chunk is over
+	transition.assign((size_t)(numStates * numStates), 0.0);
+	stateResponses.assign((size_t)(numStates * chunkLength), 0.0);
+	responseLength = 0;
+
+	std::vector<double> states((size_t)(numStates * numStates), 0.0);
+
+	for (int j = 0; j < numStates; ++j)
+		states[(size_t)(j * numStates + j)] = 1.0;
+
+	constexpr double decayedLevel = 1.0e-13;
+
+	for (int n = 0; n < chunkLength; ++n)
+	{
+		auto largest = 0.0;
+
+		for (int j = 0; j < numStates; ++j)
+		{
+			auto* s = states.data() + j * numStates;
+			auto y = 0.0;
+
+			for (size_t i = 0; i < sections.size(); ++i)
+			{
+				const auto& c = sections[i];
+				auto& s1 = s[i * 2];
+				auto& s2 = s[i * 2 + 1];
+
+				auto out = c[0] * y + s1;
+				s1 = c[1] * y - c[3] * out + s2;
+				s2 = c[2] * y - c[4] * out;
+				y = out;
+
+				largest = juce::jmax(largest, std::abs(s1), std::abs(s2));
+			}
+
+			stateResponses[(size_t)(j * chunkLength + n)] = y;
+		}
+
+		responseLength = n + 1;
+
+		//Past here nothing a state leaves behind is big enough to change a sample
+		if (largest < decayedLevel)
+			break;
+	}
+
+	//Rung out states stay at zero in the transition
+	if (responseLength == chunkLength)
+		for (int j = 0; j < numStates; ++j)
+			for (int i = 0; i < numStates; ++i)
+				transition[(size_t)(i * numStates + j)] = states[(size_t)(j * numStates + i)];
+
+	channels.resize((size_t)numChannels);
+
+	for (auto& channel : channels)
+		channel.carry.assign((size_t)numStates, 0.0);
+
+	reset();
+}
+
+void ParallelCascade::reset()
+{
+	for (auto& channel : channels)
+		std::fill(channel.carry.begin(), channel.carry.end(), 0.0);
+}
+
+void ParallelCascade::process(juce::AudioBuffer<float>& block)
+{
+	auto numSamples = block.getNumSamples();
+	auto numChannels = juce::jmin((int)channels.size(), block.getNumChannels());
+	auto numChunks = (numSamples + chunkLength - 1) / chunkLength;
+
+	if (numChunks == 0)
+		return;
+
+	for (int ch = 0; ch < numChannels; ++ch)
+	{
+		auto& channel = channels[(size_t)ch];
+		channel.samples.resize((size_t)numSamples);
+		channel.endStates.resize((size_t)(numChunks * numStates));
+		channel.startStates.resize((size_t)(numChunks * numStates));
+
+		auto* source = block.getReadPointer(ch);
+		std::copy(source, source + numSamples, channel.samples.begin());
+	}
+
+	auto getChunkSize = [this, numSamples](int chunk) { return juce::jmin(chunkLength, numSamples - chunk * chunkLength); };
+
+	//Every chunk of every channel from zero state
+	parallelFor(numChannels * numChunks, [&](int job)
+		{
+			auto& channel = channels[(size_t)(job / numChunks)];
+			auto chunk = job % numChunks;
+
+			filterFromZero(channel.samples.data() + chunk * chunkLength, getChunkSize(chunk), channel.endStates.data() + chunk * numStates);
+		});
+
+	//The true start of each chunk is the last one carried over a chunk, plus what the last chunk left from zero
+	std::vector<double> propagated((size_t)numStates);
+
+	for (int ch = 0; ch < numChannels; ++ch)
+	{
+		auto& channel = channels[(size_t)ch];
+		auto* start = channel.carry.data();
+
+		for (int chunk = 0; chunk < numChunks; ++chunk)
+		{
+			auto* chunkStart = channel.startStates.data() + chunk * numStates;
+			std::copy(start, start + numStates, chunkStart);
+
+			//Only whole chunks carry on, a short one ends the stream
+			if (getChunkSize(chunk) < chunkLength)
+				break;
+
+			auto* next = chunk + 1 < numChunks ? channel.startStates.data() + (chunk + 1) * numStates : channel.carry.data();
+			auto* zeroEnd = channel.endStates.data() + chunk * numStates;
+
+			for (int i = 0; i < numStates; ++i)
+			{
+				auto sum = zeroEnd[i];
+
+				for (int j = 0; j < numStates; ++j)
+					sum += transition[(size_t)(i * numStates + j)] * chunkStart[j];
+
+				propagated[(size_t)i] = sum;
+			}
+
+			std::copy(propagated.begin(), propagated.end(), next);
+			start = next;
+		}
+	}
+
+	parallelFor(numChannels * numChunks, [&](int job)
+		{
+			auto& channel = channels[(size_t)(job / numChunks)];
+			auto chunk = job % numChunks;
+
+			addStateResponse(channel.samples.data() + chunk * chunkLength, getChunkSize(chunk), channel.startStates.data() + chunk * numStates);
+		});
+
+	for (int ch = 0; ch < numChannels; ++ch)
+	{
+		auto* destination = block.getWritePointer(ch);
+		const auto& samples = channels[(size_t)ch].samples;
+
+		for (int i = 0; i < numSamples; ++i)
+			destination[i] = (float)samples[(size_t)i];
+	}
+}
+
+void ParallelCascade::filterFromZero(double* samples, int numSamples, double* endState) const
+{
+	//A section at a time over the whole chunk, the chunk stays in cache
+	for (size_t i = 0; i < sections.size(); ++i)
+	{
+		const auto& c = sections[i];
+		auto s1 = 0.0, s2 = 0.0;
+
+		for (int n = 0; n < numSamples; ++n)
+		{
+			auto x = samples[n];
+			auto y = c[0] * x + s1;
+			s1 = c[1] * x - c[3] * y + s2;
+			s2 = c[2] * x - c[4] * y;
+			samples[n] = y;
+		}
+
+		endState[i * 2] = s1;
+		endState[i * 2 + 1] = s2;
+	}
+}
+
+void ParallelCascade::addStateResponse(double* samples, int numSamples, const double* startState) const
+{
+	auto length = juce::jmin(numSamples, responseLength);
+
+	for (int j = 0; j < numStates; ++j)
+	{
+		auto weight = startState[j];
+
+		if (weight == 0.0)
+			continue;
+
+		auto* response = stateResponses.data() + j * chunkLength;
+
+		for (int n = 0; n < length; ++n)
+			samples[n] += weight * response[n];
+	}
+}
+
+void ParallelCascade::parallelFor(int numJobs, const std::function<void(int)>& job)
+{
+	std::atomic<int> remaining{ numJobs };
+	juce::WaitableEvent done;
+
+	for (int i = 0; i < numJobs; ++i)
+	{
+		pool.addJob([&job, &remaining, &done, i]
+			{
+				job(i);
+
+				if (--remaining == 0)
+					done.signal();
+			});
+	}
+
+	done.wait(-1);
+}
@@ -0,0 +1,71 @@
+/*
+  ==============================================================================
+
+	Chunk parallel filtering of one long stream through a biquad cascade.
+
+	A block is cut into chunks that are filtered at the same time, each from
+	zero state. The cascade is linear, so what a chunk misses is the response
+	of the cascade to the state it should have started from with no input,
+	and that response is linear in the state. Once per prepare, every unit
+	state is run through the cascade, which gives its zero input response and
+	where it ends up a chunk later. The true start states then follow chunk
+	by chunk with one small matrix product each, and every chunk adds the
+	weighted responses to its output, in parallel again.
+
+	The responses are cut off once every state has decayed below 1e-13 of
+	its start, so the result matches sequential filtering to rounding.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../Source/FilterDesign.h"
+
+class ParallelCascade
+{
+public:
+	explicit ParallelCascade(int numThreads);
+
+	//Any sections in series, transposed direct form II in double precision
+	void prepare(const std::vector<BiquadCoefficients<double>>& sections, int numChannels, int chunkLength);
+
+	//Starts a new stream from silence
+	void reset();
+
+	/*
+	 Filters the block as the continuation of the blocks before it. Every chunk but the last has to be chunkLength long,
+	 a shorter one ends the stream.
+	 */
+	void process(juce::AudioBuffer<float>& block);
+
+	int getChunkLength() const { return chunkLength; }
+
+private:
+	juce::ThreadPool pool;
+
+	std::vector<BiquadCoefficients<double>> sections;
+	int numStates = 0, chunkLength = 0, responseLength = 0;
+
+	//The zero input output of each unit state, responseLength samples each
+	std::vector<double> stateResponses;
+	//Column j is where unit state j is chunkLength samples later
+	std::vector<double> transition;
+
+	struct ChannelState
+	{
+		std::vector<double> samples;
+		//Per chunk, the state at its end when filtered from zero, then the true state at its start
+		std::vector<double> endStates, startStates;
+		std::vector<double> carry;
+	};
+
+	std::vector<ChannelState> channels;
+
+	void filterFromZero(double* samples, int numSamples, double* endState) const;
+	void addStateResponse(double* samples, int numSamples, const double* startState) const;
+
+	//Runs job(0) .. job(numJobs - 1) on the pool and waits for all of them
+	void parallelFor(int numJobs, const std::function<void(int)>& job);
+};
@@ -0,0 +1,216 @@
+/*
+  ==============================================================================
+
+	Bounded memory rendering of one file, see StreamingRender.h.
+
+  ==============================================================================
+*/
+
+#include "StreamingRender.h"
+
+void BlockHandoff::prepare(int numChannels, int blockSize)
+{
+	for (auto& slot : slots)
+	{
+		slot.buffer.setSize(numChannels, blockSize);
+		slot.full = false;
+	}
+
+	writeIndex = readIndex = 0;
+	finished = false;
+	cancelled = false;
+}
+
+juce::AudioBuffer<float>* BlockHandoff::beginWrite()
+{
+	auto& slot = slots[(size_t)writeIndex];
+
+	//The timeout only guards against a cancel racing the wait
+	while (slot.full.load() && !cancelled.load())
+		slotEmptied.wait(100);
+
+	return cancelled.load() ? nullptr : &slot.buffer;
+}
+
+void BlockHandoff::endWrite(int startSample, int numSamples)
+{
+	auto& slot = slots[(size_t)writeIndex];
+	slot.startSample = startSample;
+	slot.numSamples = numSamples;
+	slot.full = true;
+
+	writeIndex ^= 1;
+	slotFilled.signal();
+}
+
+void BlockHandoff::finish()
+{
+	finished = true;
+	slotFilled.signal();
+}
+
+const juce::AudioBuffer<float>* BlockHandoff::beginRead(int& startSample, int& numSamples)
+{
+	auto& slot = slots[(size_t)readIndex];
+
+	while (!slot.full.load())
+	{
+		//Checked again after finished, the last block may have been handed over in between
+		if (cancelled.load() || (finished.load() && !slot.full.load()))
+			return nullptr;
+
+		slotFilled.wait(100);
+	}
+
+	startSample = slot.startSample;
+	numSamples = slot.numSamples;
+	return &slot.buffer;
+}
+
+void BlockHandoff::endRead()
+{
+	slots[(size_t)readIndex].full = false;
+
+	readIndex ^= 1;
+	slotEmptied.signal();
+}
+
+void BlockHandoff::cancel()
+{
+	cancelled = true;
+	slotFilled.signal();
+	slotEmptied.signal();
+}
+
+//==============================================================================
+namespace
+{
+	struct JobThread : juce::Thread
+	{
+		JobThread(const juce::String& name, std::function<void()> jobToRun) : juce::Thread(name), job(std::move(jobToRun)) {}
+
+		void run() override { job(); }
+
+		std::function<void()> job;
+	};
+}
+
+StreamingRender::StreamingRender(std::function<void(juce::AudioBuffer<float>&)> processBlockToUse, juce::AudioFormatReader& readerToUse,
+	juce::MemoryMappedAudioFormatReader* mappedReaderToUse, juce::AudioFormatWriter& writerToUse, int blockSizeToUse, int latencySamples)
+	: processBlock(std::move(processBlockToUse)), reader(readerToUse), mappedReader(mappedReaderToUse), writer(writerToUse),
+	blockSize(blockSizeToUse), numChannels((int)readerToUse.numChannels),
+	latency(latencySamples), inputLength(readerToUse.lengthInSamples)
+{
+}
+
+bool StreamingRender::run()
+{
+	input.prepare(numChannels, blockSize);
+	output.prepare(numChannels, blockSize);
+
+	JobThread readThread("SoundWizard Read", [this] { readAll(); });
+	JobThread writeThread("SoundWizard Write", [this] { writeAll(); });
+
+	readThread.startThread();
+	writeThread.startThread();
+
+	int startSample = 0, numSamples = 0;
+	juce::int64 position = 0;
+
+	//The DSP runs here, between the two handoffs
+	while (auto* source = input.beginRead(startSample, numSamples))
+	{
+		auto* destination = output.beginWrite();
+
+		if (destination == nullptr)
+		{
+			input.cancel();
+			break;
+		}
+
+		for (int channel = 0; channel < numChannels; ++channel)
+			destination->copyFrom(channel, 0, *source, channel, 0, numSamples);
+
+		input.endRead();
+
+		juce::AudioBuffer<float> block(destination->getArrayOfWritePointers(), numChannels, numSamples);
+		processBlock(block);
+
+		auto skip = (int)juce::jlimit((juce::int64)0, (juce::int64)numSamples, latency - position);
+		position += numSamples;
+
+		output.endWrite(skip, numSamples - skip);
+	}
+
+	output.finish();
+
+	readThread.waitForThreadToExit(-1);
+	writeThread.waitForThreadToExit(-1);
+
+	return !failed.load();
+}
+
+void StreamingRender::readAll()
+{
+	auto totalLength = inputLength + latency;
+	auto mappedEnd = (juce::int64)0;
+
+	for (juce::int64 position = 0; position < totalLength; position += blockSize)
+	{
+		auto* buffer = input.beginWrite();
+
+		if (buffer == nullptr)
+			return;
+
+		auto numSamples = (int)juce::jmin((juce::int64)blockSize, totalLength - position);
+		auto numToRead = (int)juce::jlimit((juce::int64)0, (juce::int64)numSamples, inputLength - position);
+
+		buffer->clear();
+
+		if (numToRead > 0)
+		{
+			//Only one window is mapped at a time, so the resident part of the file stays the same size
+			if (mappedReader != nullptr && position + numToRead > mappedEnd)
+			{
+				mappedEnd = juce::jmin(inputLength, position + (juce::int64)blockSize * blocksPerMappedWindow);
+
+				if (!mappedReader->mapSectionOfFile({ position, mappedEnd }))
+				{
+					failed = true;
+					input.cancel();
+					return;
+				}
+			}
+
+			juce::AudioBuffer<float> block(buffer->getArrayOfWritePointers(), numChannels, numToRead);
+
+			if (!reader.read(&block, 0, numToRead, position, true, true))
+			{
+				failed = true;
+				input.cancel();
+				return;
+			}
+		}
+
+		input.endWrite(0, numSamples);
+	}
+
+	input.finish();
+}
+
+void StreamingRender::writeAll()
+{
+	int startSample = 0, numSamples = 0;
+
+	while (auto* block = output.beginRead(startSample, numSamples))
+	{
+		if (numSamples > 0 && !writer.writeFromAudioSampleBuffer(*block, startSample, numSamples))
+		{
+			failed = true;
+			output.cancel();
+			return;
+		}
+
+		output.endRead();
+	}
+}
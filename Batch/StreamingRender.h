@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+	Bounded memory rendering of one file.
+
+	A reader thread, the calling thread running the processor and a writer
+	thread are chained by double buffers of one block each, so disk reads, DSP
+	and disk writes overlap. Nothing grows with the length of the file: WAV and
+	AIFF inputs are memory mapped a window at a time, everything else is
+	decoded a block at a time.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//Two blocks handed back and forth between one producer and one consumer thread
+class BlockHandoff
+{
+public:
+	void prepare(int numChannels, int blockSize);
+
+	//Producer. Waits for a free block, nullptr if the consumer cancelled
+	juce::AudioBuffer<float>* beginWrite();
+	//Hands the block over, the consumer uses numSamples of it from startSample
+	void endWrite(int startSample, int numSamples);
+	//No more blocks will follow
+	void finish();
+
+	//Consumer. Waits for a full block, nullptr once the producer finished and everything was read
+	const juce::AudioBuffer<float>* beginRead(int& startSample, int& numSamples);
+	void endRead();
+
+	//Either side gives up, the other one stops waiting
+	void cancel();
+	bool isCancelled() const { return cancelled.load(); }
+
+private:
+	struct Slot
+	{
+		juce::AudioBuffer<float> buffer;
+		int startSample = 0, numSamples = 0;
+		std::atomic<bool> full{ false };
+	};
+
+	std::array<Slot, 2> slots;
+	int writeIndex = 0, readIndex = 0;
+
+	std::atomic<bool> finished{ false }, cancelled{ false };
+	juce::WaitableEvent slotFilled, slotEmptied;
+};
+
+class StreamingRender
+{
+public:
+	/*
+	 Renders all of reader into writer through processBlock, in blocks of blockSize. If mappedReader is given it is
+	 the same reader, and it is mapped a window at a time. The latency is dropped from the start of the output and made up with
+	 silence at the end, so the output lines up with the input.
+	 */
+	StreamingRender(std::function<void(juce::AudioBuffer<float>&)> processBlock, juce::AudioFormatReader& reader,
+		juce::MemoryMappedAudioFormatReader* mappedReader, juce::AudioFormatWriter& writer, int blockSize, int latencySamples);
+
+	//Returns false if reading or writing failed, what is written so far stays on disk
+	bool run();
+
+private:
+	//Blocks per mapped window of the input
+	static constexpr int blocksPerMappedWindow = 16;
+
+	std::function<void(juce::AudioBuffer<float>&)> processBlock;
+	juce::AudioFormatReader& reader;
+	juce::MemoryMappedAudioFormatReader* mappedReader;
+	juce::AudioFormatWriter& writer;
+
+	const int blockSize;
+	const int numChannels;
+	const juce::int64 latency, inputLength;
+
+	BlockHandoff input, output;
+	std::atomic<bool> failed{ false };
+
+	void readAll();
+	void writeAll();
+};
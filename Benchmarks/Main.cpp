@@ -0,0 +1,379 @@
+/*
+  ==============================================================================
+
+	SoundWizard micro benchmarks.
+
+	Times the DSP and analyzer hot paths straight from the plugin sources, with
+	no host and no editor on screen, and prints the results as JSON so runs of
+	different releases can be compared.
+
+	SoundWizardBenchmarks [--output <file.json>]
+
+	Every result has a "benchmark" name, the settings it ran with and either
+	"nsPerSample" or "nsPerCall".
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../Source/PluginProcessor.h"
+#include "../Source/PluginEditor.h"
+
+#include <iostream>
+
+namespace
+{
+	//Samples per channel each processBlock run covers, long enough to average over many blocks
+	constexpr int samplesPerRun = 1 << 15;
+
+	juce::Array<juce::var> results;
+
+	void addResult(const juce::String& benchmark, const juce::NamedValueSet& settings, const char* unit, double value)
+	{
+		auto* result = new juce::DynamicObject();
+		result->setProperty("benchmark", benchmark);
+
+		for (const auto& setting : settings)
+			result->setProperty(setting.name, setting.value);
+
+		result->setProperty(unit, value);
+		results.add(juce::var(result));
+	}
+
+	//Nanoseconds per call of fn, after one call to warm the caches
+	template<typename Function>
+	double timeCalls(int numCalls, Function&& fn)
+	{
+		fn();
+
+		auto start = juce::Time::getHighResolutionTicks();
+
+		for (int i = 0; i < numCalls; ++i)
+			fn();
+
+		auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+		return elapsed * 1.0e9 / numCalls;
+	}
+
+	void setParameter(SoundWizardAudioProcessor& processor, const juce::String& id, float value)
+	{
+		if (auto* parameter = dynamic_cast<juce::RangedAudioParameter*>(processor.apvts.getParameter(id)))
+			parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+	}
+
+	struct BlockConfig
+	{
+		double sampleRate = 48000.0;
+		int blockSize = 512;
+		int numChannels = 2;
+		bool doublePrecision = false;
+		Slope lowCutSlope = S_12, highCutSlope = S_12;
+		UpdateGrid grid = G_32;
+	};
+
+	template<typename SampleType>
+	double timeProcessBlock(const BlockConfig& config)
+	{
+		SoundWizardAudioProcessor processor;
+
+		auto channelSet = juce::AudioChannelSet::canonicalChannelSet(config.numChannels);
+
+		if (channelSet.isDisabled())
+			channelSet = juce::AudioChannelSet::discreteChannels(config.numChannels);
+
+		juce::AudioProcessor::BusesLayout layout;
+		layout.inputBuses.add(channelSet);
+		layout.outputBuses.add(channelSet);
+		processor.setBusesLayout(layout);
+
+		setParameter(processor, "LowCut Slope", (float)config.lowCutSlope);
+		setParameter(processor, "HighCut Slope", (float)config.highCutSlope);
+		setParameter(processor, "Update Grid", (float)config.grid);
+
+		processor.setProcessingPrecision(config.doublePrecision ? juce::AudioProcessor::doublePrecision
+		                                                        : juce::AudioProcessor::singlePrecision);
+		processor.setRateAndBufferSizeDetails(config.sampleRate, config.blockSize);
+		processor.prepareToPlay(config.sampleRate, config.blockSize);
+
+		//Noise, so nothing is skipped as silent
+		juce::AudioBuffer<SampleType> buffer(config.numChannels, config.blockSize);
+		juce::Random random(1);
+
+		for (int channel = 0; channel < config.numChannels; ++channel)
+			for (int i = 0; i < config.blockSize; ++i)
+				buffer.setSample(channel, i, (SampleType)(random.nextFloat() * 0.5f - 0.25f));
+
+		juce::MidiBuffer midi;
+		auto numBlocks = juce::jmax(1, samplesPerRun / config.blockSize);
+
+		auto nsPerBlock = timeCalls(numBlocks, [&] { processor.processBlock(buffer, midi); });
+
+		processor.releaseResources();
+
+		return nsPerBlock / (config.blockSize * config.numChannels);
+	}
+
+	juce::NamedValueSet describe(const BlockConfig& config)
+	{
+		juce::NamedValueSet settings;
+		settings.set("sampleRate", config.sampleRate);
+		settings.set("blockSize", config.blockSize);
+		settings.set("channels", config.numChannels);
+		settings.set("precision", config.doublePrecision ? "double" : "float");
+		settings.set("lowCutSlope", 12 * (config.lowCutSlope + 1));
+		settings.set("highCutSlope", 12 * (config.highCutSlope + 1));
+		settings.set("updateGrid", getUpdateGridSize(config.grid));
+		return settings;
+	}
+
+	void runProcessBlock(const BlockConfig& config)
+	{
+		auto ns = config.doublePrecision ? timeProcessBlock<double>(config) : timeProcessBlock<float>(config);
+		addResult("processBlock", describe(config), "nsPerSample", ns);
+	}
+
+	void benchmarkProcessBlock()
+	{
+		//Block sizes, rates and channel counts at the default slopes, in both precisions
+		for (auto doublePrecision : { false, true })
+			for (auto sampleRate : { 44100.0, 48000.0, 96000.0, 192000.0 })
+				for (auto blockSize : { 1, 16, 64, 256, 1024, 4096 })
+					for (auto numChannels : { 1, 2, 8 })
+					{
+						BlockConfig config;
+						config.doublePrecision = doublePrecision;
+						config.sampleRate = sampleRate;
+						config.blockSize = blockSize;
+						config.numChannels = numChannels;
+						runProcessBlock(config);
+					}
+
+		//Every slope combination at one typical setting
+		for (auto doublePrecision : { false, true })
+			for (int low = S_12; low <= S_96; ++low)
+				for (int high = S_12; high <= S_96; ++high)
+				{
+					BlockConfig config;
+					config.doublePrecision = doublePrecision;
+					config.lowCutSlope = static_cast<Slope>(low);
+					config.highCutSlope = static_cast<Slope>(high);
+					runProcessBlock(config);
+				}
+	}
+
+	/*
+	 What a ramping parameter costs at each redesign grid, timed on this thread in its two halves:
+	 the designer thread laying out the whole ramp and the audio thread applying one step of it.
+	 Timing processBlock while the peak moves would depend on when the designer thread gets scheduled.
+	 */
+	template<typename SampleType>
+	void benchmarkCoefficientRamp(const char* precision)
+	{
+		constexpr auto doublePrecision = std::is_same_v<SampleType, double>;
+
+		for (auto sampleRate : { 44100.0, 96000.0, 192000.0 })
+			for (int grid = G_16; grid <= G_PerBlock; ++grid)
+			{
+				SoundWizardAudioProcessor processor;
+
+				setParameter(processor, "LowCut Slope", (float)S_96);
+				setParameter(processor, "HighCut Slope", (float)S_96);
+				setParameter(processor, "Update Grid", (float)grid);
+
+				processor.setProcessingPrecision(doublePrecision ? juce::AudioProcessor::doublePrecision
+				                                                 : juce::AudioProcessor::singlePrecision);
+				processor.setRateAndBufferSizeDetails(sampleRate, 512);
+				processor.prepareToPlay(sampleRate, 512);
+
+				//Stops the designer threads, the chain and the ramps stay allocated
+				processor.releaseResources();
+
+				//No samples go by, so every forced design lays out the same whole ramp towards the new peak
+				setParameter(processor, "Peak Freq", 2000.f);
+
+				auto designNs = timeCalls(200, [&] { processor.designRampNow<SampleType>(); });
+
+				auto numSteps = processor.pullRampNow<SampleType>();
+				auto step = 0;
+
+				auto applyNs = timeCalls(10000, [&] { processor.applyRampStepNow<SampleType>(step++ % numSteps); });
+
+				juce::NamedValueSet description;
+				description.set("precision", precision);
+				description.set("sampleRate", sampleRate);
+				description.set("updateGrid", getUpdateGridSize(static_cast<UpdateGrid>(grid)));
+				description.set("slopes", 96);
+				description.set("steps", numSteps);
+
+				addResult("designCoefficientRamp", description, "nsPerCall", designNs);
+				addResult("applyRampStep", description, "nsPerCall", applyNs);
+			}
+	}
+
+	void benchmarkSampleQueue()
+	{
+		for (auto blockSize : { 16, 64, 256, 1024, 4096 })
+		{
+			SingleChannelSampleQueue queue(Channel::Left);
+			queue.prepare(blockSize);
+
+			juce::AudioBuffer<float> buffer(2, blockSize);
+			buffer.clear();
+
+			//The analyzer side keeps up, so no block is dropped
+			auto ns = timeCalls(samplesPerRun / blockSize * 8, [&]
+				{
+					queue.update(buffer);
+					queue.skip(blockSize);
+				});
+
+			juce::NamedValueSet description;
+			description.set("blockSize", blockSize);
+			addResult("SingleChannelSampleQueue::update", description, "nsPerSample", ns / blockSize);
+		}
+	}
+
+	void benchmarkAnalyzer()
+	{
+		for (auto order : { FFTOrder::order2048, FFTOrder::order4096, FFTOrder::order8192 })
+		{
+			FFTDataGenerator<std::vector<float>> generator;
+			generator.changeOrder(order);
+			generator.setTiming(0.01f, 0.2f, 12.f);
+
+			auto fftSize = generator.getFFTSize();
+
+			juce::AudioBuffer<float> window(2, fftSize);
+			juce::Random random(1);
+
+			for (int channel = 0; channel < 2; ++channel)
+				for (int i = 0; i < fftSize; ++i)
+					window.setSample(channel, i, random.nextFloat() * 0.5f - 0.25f);
+
+			std::vector<float> fftData((size_t)fftSize * 2, 0.f);
+
+			auto fftNs = timeCalls(500, [&]
+				{
+					generator.produceFFTDataForRendering(window, 0, -48.f);
+
+					for (int s = 0; s < numAnalyzerSpectra; ++s)
+						generator.getFFTData(static_cast<AnalyzerSpectrum>(s), fftData);
+				});
+
+			juce::NamedValueSet description;
+			description.set("fftSize", fftSize);
+			addResult("FFTDataGenerator::produceFFTDataForRendering", description, "nsPerCall", fftNs);
+
+			//One spectrum of the data just produced, drawn into a typical editor width
+			AnalyzerPathGenerator<juce::Path> pathGenerator;
+			juce::Path path;
+			juce::Rectangle<float> bounds(0.f, 0.f, 600.f, 200.f);
+
+			auto pathNs = timeCalls(2000, [&]
+				{
+					pathGenerator.generatePath(fftData.data(), bounds, fftSize, 48000.f / (float)fftSize, -48.f);
+					pathGenerator.getPath(path);
+				});
+
+			description.set("width", 600);
+			addResult("AnalyzerPathGenerator::generatePath", description, "nsPerCall", pathNs);
+		}
+	}
+
+	void benchmarkResponseCurve()
+	{
+		FilterCoefficientSet<double> coefficients;
+		ChainSettings settings;
+		settings.lowCutSlope = S_48;
+		settings.highCutSlope = S_48;
+		makeFilterCoefficients(coefficients, settings, 48000.0);
+
+		std::vector<BiquadCoefficients<double>> sections(coefficients.lowCut.begin(), coefficients.lowCut.begin() + 4);
+		sections.push_back(coefficients.peak);
+		sections.insert(sections.end(), coefficients.highCut.begin(), coefficients.highCut.begin() + 4);
+
+		constexpr int width = 1000;
+		std::vector<double> cosW(width), cos2W(width), power(width), decibels(width);
+
+		for (int i = 0; i < width; ++i)
+		{
+			auto omega = juce::MathConstants<double>::twoPi * juce::mapToLog10((double)i / width, 20.0, 20000.0) / 48000.0;
+			cosW[(size_t)i] = std::cos(omega);
+			cos2W[(size_t)i] = std::cos(2.0 * omega);
+		}
+
+		//What ResponseCurveComponent does when every band changed
+		auto cachedNs = timeCalls(2000, [&]
+			{
+				std::fill(power.begin(), power.end(), 1.0);
+
+				for (const auto& section : sections)
+					FilterDesign::multiplyPowerResponse(section, cosW.data(), cos2W.data(), power.data(), width);
+
+				for (int i = 0; i < width; ++i)
+					decibels[(size_t)i] = 10.0 * std::log10(juce::jmax(power[(size_t)i], 1.0e-20));
+			});
+
+		//The complex evaluation per pixel the editor used to run on every repaint, for comparison
+		auto directNs = timeCalls(200, [&]
+			{
+				for (int i = 0; i < width; ++i)
+				{
+					auto freq = juce::mapToLog10((double)i / width, 20.0, 20000.0);
+					auto magnitude = 1.0;
+
+					for (const auto& section : sections)
+						magnitude *= FilterDesign::getMagnitudeForFrequency(section, freq, 48000.0);
+
+					decibels[(size_t)i] = juce::Decibels::gainToDecibels(magnitude);
+				}
+			});
+
+		juce::NamedValueSet description;
+		description.set("width", width);
+		description.set("sections", (int)sections.size());
+
+		description.set("method", "cached power response");
+		addResult("responseCurve", description, "nsPerCall", cachedNs);
+
+		description.set("method", "complex per pixel");
+		addResult("responseCurve", description, "nsPerCall", directNs);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	juce::ScopedJuceInitialiser_GUI juceInitialiser;
+	juce::ArgumentList args(argc, argv);
+
+	benchmarkProcessBlock();
+	benchmarkCoefficientRamp<float>("float");
+	benchmarkCoefficientRamp<double>("double");
+	benchmarkSampleQueue();
+	benchmarkAnalyzer();
+	benchmarkResponseCurve();
+
+	auto* report = new juce::DynamicObject();
+	report->setProperty("plugin", "SoundWizard");
+	report->setProperty("time", juce::Time::getCurrentTime().toISO8601(true));
+	report->setProperty("cpu", juce::SystemStats::getCpuModel());
+	report->setProperty("results", results);
+
+	auto json = juce::JSON::toString(juce::var(report));
+
+	if (args.containsOption("--output"))
+	{
+		auto file = juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--output"));
+
+		if (!file.replaceWithText(json))
+		{
+			std::cerr << "Could not write " << file.getFullPathName() << std::endl;
+			return 1;
+		}
+
+		return 0;
+	}
+
+	std::cout << json << std::endl;
+	return 0;
+}
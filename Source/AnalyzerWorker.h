@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+	Shared analyzer worker.
+
+	A single background thread does the analyzer work of every open editor in
+	the process: draining the sample queues, the FFTs and building the paths.
+	Editors hold it through a juce::SharedResourcePointer, so it starts with the
+	first editor and stops with the last, and the message thread is left with
+	swapping in finished paths and repainting.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+struct AnalyzerClient
+{
+	virtual ~AnalyzerClient() = default;
+
+	//Worker thread, turns whatever samples arrived into finished paths
+	virtual void runAnalysis() = 0;
+};
+
+class AnalyzerWorker : private juce::Thread
+{
+public:
+	AnalyzerWorker() : juce::Thread("SoundWizard Analyzer")
+	{
+		startThread();
+	}
+
+	~AnalyzerWorker() override
+	{
+		stopThread(1000);
+	}
+
+	void addClient(AnalyzerClient* client)
+	{
+		const juce::ScopedLock lock(clientLock);
+		clients.addIfNotAlreadyThere(client);
+	}
+
+	//Waits for a pass that is running to finish, so the client can be destroyed straight after
+	void removeClient(AnalyzerClient* client)
+	{
+		const juce::ScopedLock lock(clientLock);
+		clients.removeFirstMatchingValue(client);
+	}
+
+private:
+	//The editors repaint at 60 Hz, producing faster would only fill the path queues
+	static constexpr int intervalMs = 1000 / 60;
+
+	juce::CriticalSection clientLock;
+	juce::Array<AnalyzerClient*> clients;
+
+	void run() override
+	{
+		while (!threadShouldExit())
+		{
+			{
+				const juce::ScopedLock lock(clientLock);
+
+				for (auto* client : clients)
+					client->runAnalysis();
+			}
+
+			wait(intervalMs);
+		}
+	}
+};
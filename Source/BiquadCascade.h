@@ -0,0 +1,393 @@
+/*
+  ==============================================================================
+
+	Multichannel biquad cascade.
+
+	Channels are packed into the lanes of a SIMD register, so a stereo signal
+	runs each section's recurrence once instead of once per channel, and twelve
+	channels cost three passes on a four lane register. Sections can be bypassed
+	the same way as the stages of a juce::dsp::ProcessorChain, either for every
+	channel or for a single one.
+
+	Consecutive active sections are fused into runs. Each run length has its own
+	instantiation with the section loop unrolled at compile time, picked once per
+	block, so the per-sample loop carries no bypass checks.
+
+	A group whose input and state have both decayed below the silence threshold
+	has its state flushed to zero and is skipped until signal comes back.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "FilterDesign.h"
+
+//How channels map onto lanes, a single lane per register when SIMD is unavailable
+#if JUCE_USE_SIMD
+template<typename SampleType>
+struct CascadeLanes
+{
+	using Register = juce::dsp::SIMDRegister<SampleType>;
+
+	static constexpr size_t size = Register::size();
+
+	static Register expand(SampleType value) { return Register::expand(value); }
+	static SampleType get(const Register& r, size_t lane) { return r.get(lane); }
+	static void set(Register& r, size_t lane, SampleType value) { r.set(lane, value); }
+};
+#else
+template<typename SampleType>
+struct CascadeLanes
+{
+	using Register = SampleType;
+
+	static constexpr size_t size = 1;
+
+	static Register expand(SampleType value) { return value; }
+	static SampleType get(const Register& r, size_t) { return r; }
+	static void set(Register& r, size_t, SampleType value) { r = value; }
+};
+#endif
+
+template<typename SampleType, size_t NumSections>
+class BiquadCascade
+{
+public:
+	using Lanes = CascadeLanes<SampleType>;
+	using Register = typename Lanes::Register;
+
+	void prepare(const juce::dsp::ProcessSpec& spec)
+	{
+		numChannels = (size_t)spec.numChannels;
+		maxBlockSize = juce::jmax((size_t)1, (size_t)spec.maximumBlockSize);
+
+		channels.resize(numChannels);
+		groups.resize((numChannels + Lanes::size - 1) / Lanes::size);
+		interleaved.resize(maxBlockSize);
+
+		for (auto& group : groups)
+			group.needsRebuild = true;
+
+		reset();
+	}
+
+	void reset()
+	{
+		for (auto& group : groups)
+		{
+			for (auto& state : group.states)
+				state = { Lanes::expand(0), Lanes::expand(0) };
+
+			group.isIdle = false;
+		}
+	}
+
+	size_t getNumChannels() const { return numChannels; }
+
+	//True when every channel is silent and rung out, so processing is a no-op
+	bool isIdle() const
+	{
+		return std::all_of(groups.begin(), groups.end(), [](const Group& group) { return group.isIdle; });
+	}
+
+	//Every channel
+	void setSection(size_t index, const BiquadCoefficients<SampleType>& c)
+	{
+		for (size_t channel = 0; channel < numChannels; ++channel)
+			setSection(channel, index, c);
+	}
+
+	void setSectionBypassed(size_t index, bool shouldBeBypassed)
+	{
+		for (size_t channel = 0; channel < numChannels; ++channel)
+			setSectionBypassed(channel, index, shouldBeBypassed);
+	}
+
+	//A single channel
+	void setSection(size_t channel, size_t index, const BiquadCoefficients<SampleType>& c)
+	{
+		jassert(channel < numChannels && index < NumSections);
+
+		channels[channel].sections[index] = c;
+		groups[channel / Lanes::size].needsRebuild = true;
+	}
+
+	void setSectionBypassed(size_t channel, size_t index, bool shouldBeBypassed)
+	{
+		jassert(channel < numChannels && index < NumSections);
+
+		channels[channel].bypassed[index] = shouldBeBypassed;
+		groups[channel / Lanes::size].needsRebuild = true;
+	}
+
+	bool isSectionBypassed(size_t channel, size_t index) const { return channels[channel].bypassed[index]; }
+
+	void process(const juce::dsp::ProcessContextReplacing<SampleType>& context)
+	{
+		if (context.isBypassed)
+			return;
+
+		auto& block = context.getOutputBlock();
+		auto channelsToProcess = juce::jmin(numChannels, block.getNumChannels());
+		auto numSamples = block.getNumSamples();
+
+		for (size_t start = 0; start < numSamples; start += maxBlockSize)
+		{
+			auto numInChunk = juce::jmin(maxBlockSize, numSamples - start);
+
+			for (size_t firstChannel = 0; firstChannel < channelsToProcess; firstChannel += Lanes::size)
+				processGroup(block, firstChannel, juce::jmin(Lanes::size, channelsToProcess - firstChannel), start, numInChunk);
+		}
+	}
+
+private:
+	struct SectionCoefficients
+	{
+		Register b0, b1, b2, a1, a2;
+	};
+
+	struct SectionState
+	{
+		Register s1, s2;
+	};
+
+	//What each channel was asked for
+	struct ChannelSections
+	{
+		std::array<BiquadCoefficients<SampleType>, NumSections> sections;
+		std::array<bool, NumSections> bypassed{};
+
+		ChannelSections() { sections.fill({ 1, 0, 0, 0, 0 }); }
+	};
+
+	//A stretch of consecutive sections that are active on at least one lane
+	struct Run
+	{
+		size_t first = 0, length = 0;
+	};
+
+	//The channels sharing one register, with their coefficients packed lane by lane
+	struct Group
+	{
+		std::array<SectionCoefficients, NumSections> coefficients;
+		std::array<SectionState, NumSections> states;
+		std::array<Run, (NumSections + 1) / 2> runs;
+		size_t numRuns = 0;
+		bool needsRebuild = true;
+		bool isIdle = false;
+	};
+
+	std::vector<ChannelSections> channels;
+	std::vector<Group> groups;
+	std::vector<Register> interleaved;
+
+	size_t numChannels = 0;
+	size_t maxBlockSize = 0;
+
+	void processGroup(juce::dsp::AudioBlock<SampleType>& block, size_t firstChannel, size_t lanesInUse,
+		size_t start, size_t numSamples)
+	{
+		auto& group = groups[firstChannel / Lanes::size];
+		auto inputIsSilent = isSilent(block, firstChannel, lanesInUse, start, numSamples);
+
+		//Silence into a filter that has rung out stays silence
+		if (inputIsSilent && group.isIdle)
+			return;
+
+		auto* raw = reinterpret_cast<SampleType*>(interleaved.data());
+
+		//Unused lanes carry silence, so their state never moves
+		for (size_t lane = 0; lane < Lanes::size; ++lane)
+		{
+			if (lane < lanesInUse)
+			{
+				auto* source = block.getChannelPointer(firstChannel + lane) + start;
+
+				for (size_t i = 0; i < numSamples; ++i)
+					raw[i * Lanes::size + lane] = source[i];
+			}
+			else
+			{
+				for (size_t i = 0; i < numSamples; ++i)
+					raw[i * Lanes::size + lane] = 0;
+			}
+		}
+
+		if (group.needsRebuild)
+			rebuildGroup(group, firstChannel);
+
+		for (size_t r = 0; r < group.numRuns; ++r)
+		{
+			const auto& run = group.runs[r];
+			runTable[run.length - 1](interleaved.data(), numSamples, &group.coefficients[run.first], &group.states[run.first]);
+		}
+
+		for (size_t lane = 0; lane < lanesInUse; ++lane)
+		{
+			auto* destination = block.getChannelPointer(firstChannel + lane) + start;
+
+			for (size_t i = 0; i < numSamples; ++i)
+				destination[i] = raw[i * Lanes::size + lane];
+		}
+
+		//Same end-of-block denormal guard as juce::dsp::IIR::Filter
+		for (size_t r = 0; r < group.numRuns; ++r)
+		{
+			for (size_t index = group.runs[r].first; index < group.runs[r].first + group.runs[r].length; ++index)
+			{
+				snapToZero(group.states[index].s1);
+				snapToZero(group.states[index].s2);
+			}
+		}
+
+		//Flushing once the tail is gone means picking up again starts from a clean state
+		group.isIdle = inputIsSilent && isSilent(block, firstChannel, lanesInUse, start, numSamples) && hasSilentState(group);
+
+		if (group.isIdle)
+			for (auto& state : group.states)
+				state = { Lanes::expand(0), Lanes::expand(0) };
+	}
+
+	static bool isSilent(const juce::dsp::AudioBlock<SampleType>& block, size_t firstChannel, size_t lanesInUse,
+		size_t start, size_t numSamples)
+	{
+		for (size_t lane = 0; lane < lanesInUse; ++lane)
+		{
+			auto range = juce::FloatVectorOperations::findMinAndMax(block.getChannelPointer(firstChannel + lane) + start, (int)numSamples);
+
+			if (juce::jmax(-range.getStart(), range.getEnd()) >= (SampleType)FilterDesign::silenceThreshold)
+				return false;
+		}
+
+		return true;
+	}
+
+	static bool hasSilentState(const Group& group)
+	{
+		for (const auto& state : group.states)
+		{
+			for (size_t lane = 0; lane < Lanes::size; ++lane)
+			{
+				if (std::abs(Lanes::get(state.s1, lane)) >= (SampleType)FilterDesign::silenceThreshold
+					|| std::abs(Lanes::get(state.s2, lane)) >= (SampleType)FilterDesign::silenceThreshold)
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	/*
+	 A section is skipped when it is bypassed on every lane of the group, which keeps its state like a bypassed
+	 ProcessorChain stage. When only some lanes are bypassed those lanes get a unity biquad and a cleared state.
+	 */
+	void rebuildGroup(Group& group, size_t firstChannel)
+	{
+		const BiquadCoefficients<SampleType> unity{ 1, 0, 0, 0, 0 };
+		auto lanesInUse = juce::jmin(Lanes::size, numChannels - firstChannel);
+
+		group.numRuns = 0;
+		auto previousActive = false;
+
+		for (size_t index = 0; index < NumSections; ++index)
+		{
+			auto& c = group.coefficients[index];
+			auto& state = group.states[index];
+			auto anyActive = false;
+
+			for (size_t lane = 0; lane < Lanes::size; ++lane)
+			{
+				auto isActive = lane < lanesInUse && !channels[firstChannel + lane].bypassed[index];
+				const auto& values = isActive ? channels[firstChannel + lane].sections[index] : unity;
+
+				Lanes::set(c.b0, lane, values[0]);
+				Lanes::set(c.b1, lane, values[1]);
+				Lanes::set(c.b2, lane, values[2]);
+				Lanes::set(c.a1, lane, values[3]);
+				Lanes::set(c.a2, lane, values[4]);
+
+				anyActive = anyActive || isActive;
+			}
+
+			for (size_t lane = 0; lane < Lanes::size && anyActive; ++lane)
+			{
+				if (lane >= lanesInUse || channels[firstChannel + lane].bypassed[index])
+				{
+					Lanes::set(state.s1, lane, 0);
+					Lanes::set(state.s2, lane, 0);
+				}
+			}
+
+			if (anyActive)
+			{
+				if (!previousActive)
+					group.runs[group.numRuns++] = { index, 0 };
+
+				++group.runs[group.numRuns - 1].length;
+			}
+
+			previousActive = anyActive;
+		}
+
+		group.needsRebuild = false;
+	}
+
+	//Transposed direct form II, in the same operation order as juce::dsp::IIR::Filter
+	static Register tickSection(Register input, const SectionCoefficients& c, SectionState& state) noexcept
+	{
+		auto output = (input * c.b0) + state.s1;
+
+		state.s1 = (input * c.b1) - (output * c.a1) + state.s2;
+		state.s2 = (input * c.b2) - (output * c.a2);
+
+		return output;
+	}
+
+	template<size_t... Index>
+	static Register tickRun(Register input, const std::array<SectionCoefficients, sizeof...(Index)>& c,
+		std::array<SectionState, sizeof...(Index)>& state, std::index_sequence<Index...>) noexcept
+	{
+		((input = tickSection(input, c[Index], state[Index])), ...);
+		return input;
+	}
+
+	//Runs Length sections sample by sample, with the coefficients and state held in locals
+	template<size_t Length>
+	static void processRun(Register* data, size_t numSamples, const SectionCoefficients* coefficients,
+		SectionState* states) noexcept
+	{
+		std::array<SectionCoefficients, Length> c;
+		std::array<SectionState, Length> state;
+
+		std::copy(coefficients, coefficients + Length, c.begin());
+		std::copy(states, states + Length, state.begin());
+
+		for (size_t i = 0; i < numSamples; ++i)
+			data[i] = tickRun(data[i], c, state, std::make_index_sequence<Length>());
+
+		std::copy(state.begin(), state.end(), states);
+	}
+
+	using RunFunction = void (*)(Register*, size_t, const SectionCoefficients*, SectionState*);
+
+	template<size_t... Length>
+	static constexpr std::array<RunFunction, sizeof...(Length)> makeRunTable(std::index_sequence<Length...>)
+	{
+		return { &processRun<Length + 1>... };
+	}
+
+	//One instantiation per run length, indexed by length - 1
+	static constexpr std::array<RunFunction, NumSections> runTable = makeRunTable(std::make_index_sequence<NumSections>());
+
+	static void snapToZero(Register& r) noexcept
+	{
+		for (size_t lane = 0; lane < Lanes::size; ++lane)
+		{
+			auto value = Lanes::get(r, lane);
+			juce::dsp::util::snapToZero(value);
+			Lanes::set(r, lane, value);
+		}
+	}
+};
@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+	Preallocated oversampling for the filter chain.
+
+	Every factor up to 8x is built in both a minimum phase variant, using the
+	polyphase IIR half-band stages, and a linear phase variant, using the
+	equiripple FIR half-band stages. All of them are allocated in prepare, so
+	switching between them on the audio thread is only an index change and a
+	reset of the stage that becomes active.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+template<typename SampleType>
+class ChainOversampler
+{
+public:
+	using Stage = juce::dsp::Oversampling<SampleType>;
+
+	//Factor 2^order, order 0 means no oversampling
+	static constexpr size_t maxOrder = 3;
+
+	void prepare(const juce::dsp::ProcessSpec& spec)
+	{
+		for (size_t order = 1; order <= maxOrder; ++order)
+		{
+			for (size_t phase = 0; phase < 2; ++phase)
+			{
+				auto type = phase == 0 ? Stage::filterHalfBandPolyphaseIIR : Stage::filterHalfBandFIREquiripple;
+
+				//Integer latency, so the host can compensate it exactly
+				auto& stage = stages[order - 1][phase];
+				stage = std::make_unique<Stage>((size_t)spec.numChannels, order, type, true, true);
+				stage->initProcessing((size_t)spec.maximumBlockSize);
+			}
+		}
+
+		reset();
+	}
+
+	void reset()
+	{
+		for (auto& orderStages : stages)
+			for (auto& stage : orderStages)
+				if (stage != nullptr)
+					stage->reset();
+	}
+
+	Stage& getStage(size_t order, bool linearPhase)
+	{
+		jassert(order > 0 && order <= maxOrder);
+		return *stages[order - 1][linearPhase ? 1 : 0];
+	}
+
+	int getLatencySamples(size_t order, bool linearPhase) const
+	{
+		if (order == 0 || stages[order - 1][linearPhase ? 1 : 0] == nullptr)
+			return 0;
+
+		return juce::roundToInt(stages[order - 1][linearPhase ? 1 : 0]->getLatencyInSamples());
+	}
+
+private:
+	std::array<std::array<std::unique_ptr<Stage>, 2>, maxOrder> stages;
+};
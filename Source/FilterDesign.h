@@ -0,0 +1,198 @@
+/*
+  ==============================================================================
+
+	Allocation-free filter designers.
+
+	Every function here writes straight into caller-owned fixed-size storage
+	and does a handful of flops, so they are safe to call from the audio thread.
+	The maths runs in double, the sections are stored in the sample type of the
+	storage they are written to.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//Normalised biquad in the same order as juce::dsp::IIR::Coefficients: b0, b1, b2, a1, a2
+template<typename SampleType>
+using BiquadCoefficients = std::array<SampleType, 5>;
+
+namespace FilterDesign
+{
+	constexpr int maxButterworthOrder = 16;
+
+	//-120 dB, anything quieter counts as silence and a filter ringing below it counts as rung out
+	constexpr double silenceThreshold = 1.0e-6;
+
+	//Taylor series cosine, exact to double precision on [0, pi/2] and usable in constant expressions
+	constexpr double constexprCos(double x)
+	{
+		double term = 1.0, sum = 1.0;
+
+		for (int n = 1; n < 20; ++n)
+		{
+			term *= -x * x / double((2 * n - 1) * (2 * n));
+			sum += term;
+		}
+
+		return sum;
+	}
+
+	/*
+	 1/Q of every biquad section of an even order Butterworth filter.
+	 The poles of section k sit at angle (2k + 1) * pi / (2 * order), which gives 1/Q = 2 * cos(angle).
+	 Row i holds the sections of order 2 * (i + 1).
+	 */
+	constexpr auto makeButterworthDampingTable()
+	{
+		std::array<std::array<double, maxButterworthOrder / 2>, maxButterworthOrder / 2> table{};
+
+		for (int row = 0; row < maxButterworthOrder / 2; ++row)
+		{
+			auto order = 2 * (row + 1);
+
+			for (int section = 0; section < order / 2; ++section)
+				table[row][section] = 2.0 * constexprCos((2 * section + 1) * juce::MathConstants<double>::pi / (2.0 * order));
+		}
+
+		return table;
+	}
+
+	constexpr auto butterworthDamping = makeButterworthDampingTable();
+
+	//Writes order / 2 high-pass sections, the same response as designIIRHighpassHighOrderButterworthMethod
+	template<typename SectionArray>
+	void designButterworthHighPass(SectionArray& sections, int order, double frequency, double sampleRate)
+	{
+		jassert(order % 2 == 0 && order >= 2 && order <= maxButterworthOrder);
+		jassert((int)sections.size() >= order / 2);
+		jassert(frequency > 0 && frequency <= sampleRate * 0.5);
+
+		using SampleType = typename SectionArray::value_type::value_type;
+		const auto& damping = butterworthDamping[order / 2 - 1];
+
+		//The prewarped cutoff is shared by all sections, so there is only one trig call per design
+		auto n = std::tan(juce::MathConstants<double>::pi * frequency / sampleRate);
+		auto nSquared = n * n;
+
+		for (int i = 0; i < order / 2; ++i)
+		{
+			auto invQTimesN = damping[i] * n;
+			auto c1 = 1.0 / (1.0 + invQTimesN + nSquared);
+
+			sections[i] = { SampleType(c1),
+							SampleType(c1 * -2.0),
+							SampleType(c1),
+							SampleType(c1 * 2.0 * (nSquared - 1.0)),
+							SampleType(c1 * (1.0 - invQTimesN + nSquared)) };
+		}
+	}
+
+	//Writes order / 2 low-pass sections, the same response as designIIRLowpassHighOrderButterworthMethod
+	template<typename SectionArray>
+	void designButterworthLowPass(SectionArray& sections, int order, double frequency, double sampleRate)
+	{
+		jassert(order % 2 == 0 && order >= 2 && order <= maxButterworthOrder);
+		jassert((int)sections.size() >= order / 2);
+		jassert(frequency > 0 && frequency <= sampleRate * 0.5);
+
+		using SampleType = typename SectionArray::value_type::value_type;
+		const auto& damping = butterworthDamping[order / 2 - 1];
+
+		auto n = 1.0 / std::tan(juce::MathConstants<double>::pi * frequency / sampleRate);
+		auto nSquared = n * n;
+
+		for (int i = 0; i < order / 2; ++i)
+		{
+			auto invQTimesN = damping[i] * n;
+			auto c1 = 1.0 / (1.0 + invQTimesN + nSquared);
+
+			sections[i] = { SampleType(c1),
+							SampleType(c1 * 2.0),
+							SampleType(c1),
+							SampleType(c1 * 2.0 * (1.0 - nSquared)),
+							SampleType(c1 * (1.0 - invQTimesN + nSquared)) };
+		}
+	}
+
+	//Same response as juce::dsp::IIR::Coefficients::makePeakFilter
+	template<typename SampleType>
+	void designPeak(BiquadCoefficients<SampleType>& section, double frequency, double quality, double gainFactor, double sampleRate)
+	{
+		jassert(sampleRate > 0.0 && quality > 0.0);
+
+		auto A = juce::jmax(0.0, std::sqrt(gainFactor));
+		auto omega = (2.0 * juce::MathConstants<double>::pi * juce::jmax(frequency, 2.0)) / sampleRate;
+		auto alpha = std::sin(omega) / (quality * 2.0);
+		auto c2 = -2.0 * std::cos(omega);
+		auto alphaTimesA = alpha * A;
+		auto alphaOverA = alpha / A;
+		auto a0 = 1.0 / (1.0 + alphaOverA);
+
+		section = { SampleType((1.0 + alphaTimesA) * a0),
+					SampleType(c2 * a0),
+					SampleType((1.0 - alphaTimesA) * a0),
+					SampleType(c2 * a0),
+					SampleType((1.0 - alphaOverA) * a0) };
+	}
+
+	//Same value as juce::dsp::IIR::Coefficients::getMagnitudeForFrequency, without the reference counted object
+	template<typename SampleType>
+	double getMagnitudeForFrequency(const BiquadCoefficients<SampleType>& section, double frequency, double sampleRate)
+	{
+		auto z1 = std::polar(1.0, -2.0 * juce::MathConstants<double>::pi * frequency / sampleRate);
+		auto z2 = z1 * z1;
+
+		auto numerator = (double)section[0] + (double)section[1] * z1 + (double)section[2] * z2;
+		auto denominator = 1.0 + (double)section[3] * z1 + (double)section[4] * z2;
+
+		return std::abs(numerator / denominator);
+	}
+
+	/*
+	 Multiplies power[i] by |H|^2 of the section at the frequency whose cos(w) and cos(2w) are cosW[i] and cos2W[i].
+	 |H|^2 is a ratio of cosine polynomials, so the loop has no trig and vectorises across the points.
+	 */
+	template<typename SampleType>
+	void multiplyPowerResponse(const BiquadCoefficients<SampleType>& section, const double* cosW, const double* cos2W, double* power, int numPoints)
+	{
+		auto b0 = (double)section[0], b1 = (double)section[1], b2 = (double)section[2];
+		auto a1 = (double)section[3], a2 = (double)section[4];
+
+		auto n0 = b0 * b0 + b1 * b1 + b2 * b2, n1 = 2.0 * (b0 * b1 + b1 * b2), n2 = 2.0 * b0 * b2;
+		auto d0 = 1.0 + a1 * a1 + a2 * a2, d1 = 2.0 * (a1 + a1 * a2), d2 = 2.0 * a2;
+
+		for (int i = 0; i < numPoints; ++i)
+			power[i] *= (n0 + n1 * cosW[i] + n2 * cos2W[i]) / (d0 + d1 * cosW[i] + d2 * cos2W[i]);
+	}
+
+	//Magnitude of the slowest pole, the roots of z^2 + a1 z + a2
+	template<typename SampleType>
+	double getPoleRadius(const BiquadCoefficients<SampleType>& section)
+	{
+		auto a1 = (double)section[3], a2 = (double)section[4];
+		auto discriminant = a1 * a1 - 4.0 * a2;
+
+		//A complex pair shares one radius
+		if (discriminant < 0.0)
+			return std::sqrt(a2);
+
+		auto root = std::sqrt(discriminant);
+		return juce::jmax(std::abs(-a1 + root), std::abs(-a1 - root)) * 0.5;
+	}
+
+	//Samples until a pole of this radius has decayed to the silence threshold
+	inline double getDecaySamples(double poleRadius)
+	{
+		if (poleRadius <= 0.0)
+			return 2.0;
+
+		//A pole on or outside the unit circle never decays, report a long tail rather than infinity
+		if (poleRadius >= 1.0)
+			return 1.0e7;
+
+		return std::log(silenceThreshold) / std::log(poleRadius);
+	}
+}
@@ -0,0 +1,228 @@
+/*
+  ==============================================================================
+
+	Uniformly partitioned overlap-save convolution, see LinearPhaseConvolver.h.
+
+  ==============================================================================
+*/
+
+#include "LinearPhaseConvolver.h"
+
+void LinearPhaseConvolver::prepare(int numChannels, int kernelOrder, int partitionOrder)
+{
+	jassert(partitionOrder <= kernelOrder);
+
+	kernelLength = 1 << kernelOrder;
+	partitionSize = 1 << partitionOrder;
+	numBins = partitionSize + 1;
+	numPartitions = kernelLength / partitionSize;
+
+	//Partitions are zero padded to twice their length, so the circular convolution never wraps
+	partitionFFT = std::make_unique<juce::dsp::FFT>(partitionOrder + 1);
+	designPartitionFFT = std::make_unique<juce::dsp::FFT>(partitionOrder + 1);
+	designKernelFFT = std::make_unique<juce::dsp::FFT>(kernelOrder);
+
+	channels.resize((size_t)numChannels);
+
+	for (auto& state : channels)
+	{
+		state.input.assign((size_t)partitionSize * 2, 0.f);
+		state.output.assign((size_t)partitionSize, 0.f);
+		state.delayLine.assign((size_t)(numPartitions * numBins), {});
+	}
+
+	fftBuffer.assign((size_t)partitionSize * 4, 0.f);
+	accumulator.assign((size_t)numBins, {});
+	fadeBuffer.assign((size_t)partitionSize, 0.f);
+
+	designBuffer.assign((size_t)kernelLength * 2, 0.f);
+	designPartitionBuffer.assign((size_t)partitionSize * 4, 0.f);
+
+	//Hann taper, centred on the middle tap so it leaves the peak of the response untouched
+	window.resize((size_t)kernelLength);
+
+	for (int n = 0; n < kernelLength; ++n)
+		window[(size_t)n] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * (float)n / (float)kernelLength);
+
+	for (auto& slot : slots)
+		slot.spectra.assign((size_t)(numPartitions * numBins), {});
+
+	publishedSlot = -1;
+	slotsInUse = 0;
+	activeSlot = -1;
+
+	//About 20 ms at 48 kHz, whatever the partition size
+	fadeLength = juce::jmax(partitionSize, 1024);
+
+	reset();
+}
+
+void LinearPhaseConvolver::reset()
+{
+	for (auto& state : channels)
+	{
+		std::fill(state.input.begin(), state.input.end(), 0.f);
+		std::fill(state.output.begin(), state.output.end(), 0.f);
+		std::fill(state.delayLine.begin(), state.delayLine.end(), Complex{});
+	}
+
+	inputFill = 0;
+	delayLineHead = 0;
+
+	previousSlot = -1;
+	fadePosition = 0;
+	slotsInUse = activeSlot >= 0 ? 1 << activeSlot : 0;
+
+	adoptPublishedKernel(false);
+}
+
+bool LinearPhaseConvolver::setMagnitudeResponse(const float* magnitudes)
+{
+	//Zero phase spectrum, its inverse is a response symmetric about sample 0
+	std::fill(designBuffer.begin(), designBuffer.end(), 0.f);
+
+	for (int k = 0; k <= kernelLength / 2; ++k)
+		designBuffer[(size_t)k * 2] = magnitudes[k];
+
+	designKernelFFT->performRealOnlyInverseTransform(designBuffer.data());
+
+	//Rotate the centre to the middle tap and taper the truncated ends
+	auto impulse = designBuffer.begin() + kernelLength;
+
+	for (int n = 0; n < kernelLength; ++n)
+		impulse[n] = designBuffer[(size_t)((n + kernelLength / 2) % kernelLength)] * window[(size_t)n];
+
+	//Published first, so a slot the audio thread takes in between already shows in the mask
+	auto published = publishedSlot.load();
+	auto busy = slotsInUse.load();
+
+	if (published >= 0)
+		busy |= 1 << published;
+
+	auto slot = 0;
+
+	while (slot < numSlots && (busy & (1 << slot)) != 0)
+		++slot;
+
+	if (slot == numSlots)
+		return false;
+
+	auto* spectra = slots[(size_t)slot].spectra.data();
+
+	for (int p = 0; p < numPartitions; ++p)
+	{
+		std::fill(designPartitionBuffer.begin(), designPartitionBuffer.end(), 0.f);
+		std::copy(impulse + p * partitionSize, impulse + (p + 1) * partitionSize, designPartitionBuffer.begin());
+
+		designPartitionFFT->performRealOnlyForwardTransform(designPartitionBuffer.data(), true);
+
+		auto* bins = reinterpret_cast<const Complex*>(designPartitionBuffer.data());
+		std::copy(bins, bins + numBins, spectra + p * numBins);
+	}
+
+	publishedSlot.exchange(slot);
+	return true;
+}
+
+void LinearPhaseConvolver::adoptPublishedKernel(bool crossfade)
+{
+	//Only one crossfade at a time, a newer kernel waits for the current one to finish
+	if (previousSlot >= 0)
+		return;
+
+	auto slot = publishedSlot.load();
+
+	if (slot < 0)
+		return;
+
+	//Claim the slot before taking it, the designer checks the mask after the published index
+	auto inUse = slotsInUse.load();
+	slotsInUse = inUse | (1 << slot);
+
+	if (!publishedSlot.compare_exchange_strong(slot, -1))
+	{
+		slotsInUse = inUse;
+		return;
+	}
+
+	if (crossfade && activeSlot >= 0)
+	{
+		previousSlot = activeSlot;
+		fadePosition = 0;
+	}
+
+	activeSlot = slot;
+	slotsInUse = (1 << activeSlot) | (previousSlot >= 0 ? 1 << previousSlot : 0);
+}
+
+void LinearPhaseConvolver::processPartition()
+{
+	adoptPublishedKernel(true);
+
+	for (auto& state : channels)
+	{
+		std::copy(state.input.begin(), state.input.end(), fftBuffer.begin());
+		std::fill(fftBuffer.begin() + partitionSize * 2, fftBuffer.end(), 0.f);
+
+		partitionFFT->performRealOnlyForwardTransform(fftBuffer.data(), true);
+
+		auto* bins = reinterpret_cast<const Complex*>(fftBuffer.data());
+		std::copy(bins, bins + numBins, state.delayLine.begin() + delayLineHead * numBins);
+
+		if (activeSlot >= 0)
+			convolve(state, slots[(size_t)activeSlot], state.output.data());
+		else
+			std::fill(state.output.begin(), state.output.end(), 0.f);
+
+		if (previousSlot >= 0)
+		{
+			convolve(state, slots[(size_t)previousSlot], fadeBuffer.data());
+
+			for (int i = 0; i < partitionSize; ++i)
+			{
+				auto gain = (float)(fadePosition + i + 1) / (float)fadeLength;
+				state.output[(size_t)i] = fadeBuffer[(size_t)i] + gain * (state.output[(size_t)i] - fadeBuffer[(size_t)i]);
+			}
+		}
+
+		//The current partition becomes the first half of the next window
+		std::copy(state.input.begin() + partitionSize, state.input.end(), state.input.begin());
+	}
+
+	delayLineHead = (delayLineHead + 1) % numPartitions;
+
+	if (previousSlot >= 0)
+	{
+		fadePosition += partitionSize;
+
+		if (fadePosition >= fadeLength)
+		{
+			previousSlot = -1;
+			slotsInUse = 1 << activeSlot;
+		}
+	}
+}
+
+void LinearPhaseConvolver::convolve(const ChannelState& state, const KernelSlot& kernel, float* destination)
+{
+	std::fill(accumulator.begin(), accumulator.end(), Complex{});
+
+	//Partition p of the kernel meets the input from p partitions ago
+	for (int p = 0; p < numPartitions; ++p)
+	{
+		auto line = (delayLineHead - p + numPartitions) % numPartitions;
+		auto* x = state.delayLine.data() + line * numBins;
+		auto* h = kernel.spectra.data() + p * numBins;
+
+		for (int k = 0; k < numBins; ++k)
+			accumulator[(size_t)k] += x[k] * h[k];
+	}
+
+	auto* bins = reinterpret_cast<Complex*>(fftBuffer.data());
+	std::copy(accumulator.begin(), accumulator.end(), bins);
+
+	partitionFFT->performRealOnlyInverseTransform(fftBuffer.data());
+
+	//Overlap-save keeps the second half, the first half is wrapped around
+	std::copy(fftBuffer.begin() + partitionSize, fftBuffer.begin() + partitionSize * 2, destination);
+}
@@ -0,0 +1,128 @@
+/*
+  ==============================================================================
+
+	Linear phase FIR filtering by uniformly partitioned overlap-save convolution.
+
+	The kernel is cut into partitions of the block size B, and each partition
+	is transformed once with a 2B point FFT. Every B input samples are
+	transformed once and pushed into a frequency domain delay line. A single
+	inverse FFT of the summed partition products then gives the next B output
+	samples, so a longer kernel only adds complex multiply-adds. The latency
+	is B plus half the kernel.
+
+	Kernels are built off the audio thread into spare slots. They are picked
+	up at the next partition boundary and crossfaded from the previous one.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class LinearPhaseConvolver
+{
+public:
+	//Message thread, allocates everything for kernels of 2^kernelOrder taps and partitions of 2^partitionOrder
+	void prepare(int numChannels, int kernelOrder, int partitionOrder);
+
+	//Clears the signal state and takes the newest kernel straight away, without a crossfade
+	void reset();
+
+	int getKernelLength() const { return kernelLength; }
+	int getPartitionSize() const { return partitionSize; }
+	int getLatencySamples() const { return partitionSize + kernelLength / 2; }
+
+	/*
+	 Background thread. Takes kernelLength / 2 + 1 magnitudes evenly spaced from DC to Nyquist and publishes
+	 the zero phase kernel they describe, delayed by half its length. Returns false when every slot is busy.
+	 */
+	bool setMagnitudeResponse(const float* magnitudes);
+
+	template<typename SampleType>
+	void process(const juce::dsp::ProcessContextReplacing<SampleType>& context)
+	{
+		if (context.isBypassed)
+			return;
+
+		auto& block = context.getOutputBlock();
+		auto channelsToProcess = juce::jmin(channels.size(), block.getNumChannels());
+		auto numSamples = block.getNumSamples();
+
+		for (size_t start = 0; start < numSamples;)
+		{
+			auto numInStep = juce::jmin(numSamples - start, (size_t)(partitionSize - inputFill));
+
+			for (size_t channel = 0; channel < channelsToProcess; ++channel)
+			{
+				auto& state = channels[channel];
+				auto* data = block.getChannelPointer(channel) + start;
+
+				for (size_t i = 0; i < numInStep; ++i)
+				{
+					state.input[(size_t)(partitionSize + inputFill) + i] = static_cast<float>(data[i]);
+					data[i] = static_cast<SampleType>(state.output[(size_t)inputFill + i]);
+				}
+			}
+
+			inputFill += (int)numInStep;
+			start += numInStep;
+
+			if (inputFill == partitionSize)
+			{
+				processPartition();
+				inputFill = 0;
+			}
+		}
+	}
+
+private:
+	using Complex = std::complex<float>;
+
+	static constexpr int numSlots = 4;
+
+	//Frequency domain partitions of one kernel
+	struct KernelSlot
+	{
+		std::vector<Complex> spectra;
+	};
+
+	struct ChannelState
+	{
+		//The previous and the current partition of input, the overlap-save window
+		std::vector<float> input;
+		std::vector<float> output;
+		std::vector<Complex> delayLine;
+	};
+
+	int kernelLength = 0, partitionSize = 0, numBins = 0, numPartitions = 0;
+
+	std::vector<ChannelState> channels;
+	int inputFill = 0;
+	int delayLineHead = 0;
+
+	//Audio thread scratch
+	std::unique_ptr<juce::dsp::FFT> partitionFFT;
+	std::vector<float> fftBuffer;
+	std::vector<Complex> accumulator;
+	std::vector<float> fadeBuffer;
+
+	//The designer has its own transforms and scratch, so it never touches audio thread memory
+	std::unique_ptr<juce::dsp::FFT> designPartitionFFT, designKernelFFT;
+	std::vector<float> designBuffer, designPartitionBuffer, window;
+
+	/*
+	 The designer writes into any slot that is neither in use nor published. The audio thread only ever takes
+	 the published slot, so with four slots there is always one free: active, fading out, published, writing.
+	 */
+	std::array<KernelSlot, numSlots> slots;
+	std::atomic<int> publishedSlot{ -1 };
+	std::atomic<int> slotsInUse{ 0 };
+
+	int activeSlot = -1, previousSlot = -1;
+	int fadeLength = 0, fadePosition = 0;
+
+	void adoptPublishedKernel(bool crossfade);
+	void processPartition();
+	void convolve(const ChannelState& state, const KernelSlot& kernel, float* destination);
+};
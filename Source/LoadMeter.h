@@ -0,0 +1,129 @@
+/*
+  ==============================================================================
+
+	DSP load of the audio callback.
+
+	The audio thread marks the end of each stage of a block and the meter
+	adds up the high resolution ticks in between. At the end of the block the
+	time spent is divided by the time the block lasts, and the results go
+	into atomics the editor reads without locks, the same measure
+	juce::AudioProcessLoadMeasurer gives, split by stage.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class LoadMeter
+{
+public:
+	enum Stage
+	{
+		Stage_Coefficients,
+		Stage_Filtering,
+		Stage_Analyzer,
+		numStages
+	};
+
+	//Loads as proportions of the real time budget, 1 is a block that took as long as it lasts
+	struct Snapshot
+	{
+		float current = 0.f, average = 0.f, worst = 0.f;
+		std::array<float, numStages> stages{};
+		juce::uint32 overruns = 0;
+	};
+
+	void prepare(double newSampleRate)
+	{
+		sampleRate = newSampleRate;
+		reset();
+	}
+
+	//Overruns stay a running count, the editor shows them relative to the count at its last click
+	void reset()
+	{
+		currentLoad = 0.f;
+		averageLoad = 0.f;
+		worstLoad = 0.f;
+
+		for (auto& stage : stageLoads)
+			stage = 0.f;
+	}
+
+	//Any thread, the editor clears the worst case on a click
+	void resetWorst() { worstLoad = 0.f; }
+
+	//Audio thread
+	void beginBlock()
+	{
+		stageTicks.fill(0);
+		lastTicks = juce::Time::getHighResolutionTicks();
+	}
+
+	//Adds the time since the last mark to stage
+	void mark(Stage stage)
+	{
+		auto ticks = juce::Time::getHighResolutionTicks();
+		stageTicks[(size_t)stage] += ticks - lastTicks;
+		lastTicks = ticks;
+	}
+
+	void endBlock(int numSamples)
+	{
+		if (sampleRate <= 0.0 || numSamples <= 0)
+			return;
+
+		auto budget = numSamples / sampleRate;
+		juce::int64 totalTicks = 0;
+
+		for (size_t i = 0; i < numStages; ++i)
+		{
+			totalTicks += stageTicks[i];
+			stageLoads[i] = (float)(juce::Time::highResolutionTicksToSeconds(stageTicks[i]) / budget);
+		}
+
+		auto load = (float)(juce::Time::highResolutionTicksToSeconds(totalTicks) / budget);
+
+		//About a second to settle, whatever the block size
+		auto alpha = (float)(1.0 - std::exp(-budget / averagingSeconds));
+
+		currentLoad = load;
+		averageLoad = averageLoad.load(std::memory_order_relaxed) + alpha * (load - averageLoad.load(std::memory_order_relaxed));
+
+		if (load > worstLoad.load(std::memory_order_relaxed))
+			worstLoad = load;
+
+		if (load > 1.f)
+			overruns.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	//Any thread, each value is current on its own, they are not one consistent set
+	Snapshot getSnapshot() const
+	{
+		Snapshot snapshot;
+		snapshot.current = currentLoad.load();
+		snapshot.average = averageLoad.load();
+		snapshot.worst = worstLoad.load();
+		snapshot.overruns = overruns.load();
+
+		for (size_t i = 0; i < numStages; ++i)
+			snapshot.stages[i] = stageLoads[i].load();
+
+		return snapshot;
+	}
+
+private:
+	static constexpr double averagingSeconds = 1.0;
+
+	double sampleRate = 0.0;
+
+	//Audio thread only
+	std::array<juce::int64, numStages> stageTicks{};
+	juce::int64 lastTicks = 0;
+
+	std::atomic<float> currentLoad{ 0.f }, averageLoad{ 0.f }, worstLoad{ 0.f };
+	std::array<std::atomic<float>, numStages> stageLoads{};
+	std::atomic<juce::uint32> overruns{ 0 };
+};
@@ -9,23 +9,36 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
-ResponseCurveComponent::ResponseCurveComponent(SoundWizardAudioProcessor& processor) :audioProcessor(processor), leftChannelQueue(&audioProcessor.leftChanelQueue)
+ResponseCurveComponent::ResponseCurveComponent(SoundWizardAudioProcessor& processor) :audioProcessor(processor),
+	leftChannelQueue(&audioProcessor.leftChanelQueue), rightChannelQueue(&audioProcessor.rightChanelQueue)
 {
 	const auto& params = audioProcessor.getParameters();
 
 	for (auto param : params)
 		param->addListener(this);
 
-	leftChannelFFTDataGenerator.changeOrder(FFTOrder::order2048);
-	monoBuffer.setSize(1, leftChannelFFTDataGenerator.getFFTSize());
+	analyzerResolutionParameter = audioProcessor.apvts.getRawParameterValue("Analyzer Resolution");
+	analyzerOverlapParameter = audioProcessor.apvts.getRawParameterValue("Analyzer Overlap");
+	analyzerAveragingParameter = audioProcessor.apvts.getRawParameterValue("Analyzer Averaging");
+
+	setOpaque(true);
+
+	responseLayer.setBufferedToImage(true);
+
+	addAndMakeVisible(analyzerLayer);
+	addAndMakeVisible(responseLayer);
 
 	updateChain();
 
+	analyzerWorker->addClient(this);
+
 	startTimerHz(60);
 }
 
 ResponseCurveComponent::~ResponseCurveComponent()
 {
+	analyzerWorker->removeClient(this);
+
 	const auto& params = audioProcessor.getParameters();
 
 	for (auto param : params)
@@ -37,69 +50,292 @@ void ResponseCurveComponent::parameterValueChanged(int parameterIndex, float new
 	parametersChanged.set(true);
 }
 
-void ResponseCurveComponent::timerCallback()
+void ResponseCurveComponent::runAnalysis()
 {
-	juce::AudioBuffer<float> tempIncomingBuffer;
+	//Resolution changes are picked up here, so the message thread never sees a half built generator
+	auto requestedOrder = static_cast<FFTOrder>(FFTOrder::order2048 + (int)analyzerResolutionParameter->load());
+
+	if (stereoFFTDataGenerator == nullptr || stereoFFTDataGenerator->getOrder() != requestedOrder)
+		changeAnalyzerOrder(requestedOrder);
+
+	//One FFT per hop, whatever size the host blocks arrive in
+	std::array<SingleChannelSampleQueue*, 2> queues{ leftChannelQueue, rightChannelQueue };
+
+	const auto fftSize = stereoFFTDataGenerator->getFFTSize();
+	const auto overlap = static_cast<AnalyzerOverlap>(analyzerOverlapParameter->load());
+	const auto hopSize = fftSize >> (overlap + 1);
+	const auto sampleRate = audioProcessor.getSampleRate();
+
+	//Seconds, indexed by AnalyzerAveraging. The peak hold falls 12 dB a second
+	constexpr float averagingTimes[]{ 0.f, 0.05f, 0.2f, 0.6f };
+
+	const auto averaging = static_cast<AnalyzerAveraging>(analyzerAveragingParameter->load());
+
+	if (sampleRate > 0.0)
+		stereoFFTDataGenerator->setTiming((float)(hopSize / sampleRate), averagingTimes[averaging], 12.f);
+
+	auto numReady = 0;
+
+	if (leftChannelQueue->isPrepared() && rightChannelQueue->isPrepared())
+		numReady = juce::jmin(leftChannelQueue->getNumReady(), rightChannelQueue->getNumReady());
+
+	//After a stall only the newest window is worth analysing
+	if (numReady > fftSize)
+	{
+		for (auto* queue : queues)
+			queue->skip(numReady - fftSize);
+
+		numReady = fftSize;
+	}
+
+	while (numReady > 0)
+	{
+		//Up to the next hop, and never across the end of the ring
+		auto numToPull = juce::jmin(numReady, juce::jmax(1, hopSize - samplesSinceLastFFT), fftSize - analysisWritePosition);
+
+		for (int channel = 0; channel < 2; ++channel)
+			queues[(size_t)channel]->pull(analysisBuffer.getWritePointer(channel, analysisWritePosition), numToPull);
 
-	while (leftChannelQueue->getNumCompleteBuffersAvailable() > 0)
-		if (leftChannelQueue->getAudioBuffer(tempIncomingBuffer))
+		analysisWritePosition = (analysisWritePosition + numToPull) & (fftSize - 1);
+		samplesSinceLastFFT += numToPull;
+		numReady -= numToPull;
+
+		if (samplesSinceLastFFT >= hopSize)
 		{
-			auto size = tempIncomingBuffer.getNumSamples();
-			//shifting over the data
-			juce::FloatVectorOperations::copy(
-				monoBuffer.getWritePointer(0, 0),
-				monoBuffer.getReadPointer(0, size),
-				monoBuffer.getNumSamples() - size);
-			//copying this to the end
-			juce::FloatVectorOperations::copy(
-				monoBuffer.getWritePointer(0, monoBuffer.getNumSamples() - size),
-				tempIncomingBuffer.getReadPointer(0, 0),
-				size);
-
-			leftChannelFFTDataGenerator.produceFFTDataForRendering(monoBuffer, -48.f);
+			//The next sample to be overwritten is the oldest one in the window
+			stereoFFTDataGenerator->produceFFTDataForRendering(analysisBuffer, analysisWritePosition, -48.f);
+			samplesSinceLastFFT = 0;
 		}
+	}
 
-	const auto fftBounds = getLocalBounds().toFloat();
-	const auto fftSize = leftChannelFFTDataGenerator.getFFTSize();
+	const juce::Rectangle<float> fftBounds(analysisWidth.load(), analysisHeight.load());
 
-	const auto binWidth = audioProcessor.getSampleRate() / (double)fftSize;
+	const auto binWidth = sampleRate / (double)fftSize;
 
-	while (leftChannelFFTDataGenerator.getNumAvailableFFTDataBlocks() > 0)
+	for (int s = 0; s < numAnalyzerSpectra; ++s)
 	{
-		std::vector<float> fftData;
-		if (leftChannelFFTDataGenerator.getFFTData(fftData))
+		auto spectrum = static_cast<AnalyzerSpectrum>(s);
+		auto& pathProducer = pathProducers[(size_t)s];
+
+		while (stereoFFTDataGenerator->getNumAvailableFFTDataBlocks(spectrum) > 0)
 		{
-			pathProducer.generatePath(fftData, fftBounds, fftSize, binWidth, -48.f);
+			if (stereoFFTDataGenerator->getFFTData(spectrum, fftData))
+			{
+				//The averaged bins, then the peak hold trace
+				pathProducer.generatePath(fftData.data(), fftBounds, fftSize, binWidth, -48.f);
+				peakPathProducers[(size_t)s].generatePath(fftData.data() + fftSize / 2, fftBounds, fftSize, binWidth, -48.f);
+			}
 		}
 	}
-	while (pathProducer.getNumPathsAvailable())
+
+	publishFFTQueueStats();
+}
+
+static QueueStats combineQueueStats(QueueStats total, const QueueStats& stats)
+{
+	total.dropped += stats.dropped;
+	total.highWater = juce::jmax(total.highWater, stats.highWater);
+	total.consumerLag = juce::jmax(total.consumerLag, stats.consumerLag);
+
+	return total;
+}
+
+void ResponseCurveComponent::publishFFTQueueStats()
+{
+	QueueStats total;
+
+	for (int s = 0; s < numAnalyzerSpectra; ++s)
+		total = combineQueueStats(total, stereoFFTDataGenerator->getQueueStats(static_cast<AnalyzerSpectrum>(s)));
+
+	fftQueueDropped = retiredFFTQueueDrops + total.dropped;
+	fftQueueHighWater = total.highWater;
+	fftQueueLag = total.consumerLag;
+}
+
+QueueStats ResponseCurveComponent::getFFTQueueStats() const
+{
+	return { fftQueueDropped.load(), fftQueueHighWater.load(), fftQueueLag.load() };
+}
+
+QueueStats ResponseCurveComponent::getPathQueueStats() const
+{
+	QueueStats total;
+
+	for (int s = 0; s < numAnalyzerSpectra; ++s)
 	{
-		pathProducer.getPath(leftPanelFFTPath);
+		total = combineQueueStats(total, pathProducers[(size_t)s].getQueueStats());
+		total = combineQueueStats(total, peakPathProducers[(size_t)s].getQueueStats());
 	}
 
-	if (parametersChanged.compareAndSetBool(false, true))
+	return total;
+}
+
+void ResponseCurveComponent::changeAnalyzerOrder(FFTOrder newOrder)
+{
+	//The drops of the old queues stay in the running total
+	if (stereoFFTDataGenerator != nullptr)
+		for (int s = 0; s < numAnalyzerSpectra; ++s)
+			retiredFFTQueueDrops += stereoFFTDataGenerator->getQueueStats(static_cast<AnalyzerSpectrum>(s)).dropped;
+
+	//Built completely before it replaces the old one, which is freed with its FFT plan and window
+	auto generator = std::make_unique<FFTDataGenerator<std::vector<float>>>();
+	generator->changeOrder(newOrder);
+
+	const auto fftSize = generator->getFFTSize();
+
+	analysisBuffer.setSize(2, fftSize);
+	analysisBuffer.clear();
+	analysisWritePosition = 0;
+	samplesSinceLastFFT = 0;
+
+	fftData.assign((size_t)fftSize * 2, 0.f);
+
+	stereoFFTDataGenerator = std::move(generator);
+}
+
+void ResponseCurveComponent::timerCallback()
+{
+	//The worker did the analysis, only the finished paths are left to swap in
+	auto getStrokeBounds = [](const juce::Path& path) { return path.getBounds().expanded(2.f); };
+
+	juce::Rectangle<float> analyzerDirty;
+
+	auto pullPaths = [&](AnalyzerPathGenerator<juce::Path>& producer, juce::Path& path)
+	{
+		if (producer.getNumPathsAvailable() == 0)
+			return;
+
+		//The old trace is erased where the new one is drawn
+		analyzerDirty = analyzerDirty.getUnion(getStrokeBounds(path));
+
+		while (producer.getNumPathsAvailable())
+		{
+			producer.getPath(path);
+		}
+
+		analyzerDirty = analyzerDirty.getUnion(getStrokeBounds(path));
+	};
+
+	for (int s = 0; s < numAnalyzerSpectra; ++s)
 	{
-		//update the monochain
+		pullPaths(pathProducers[(size_t)s], analyzerPaths[(size_t)s]);
+		pullPaths(peakPathProducers[(size_t)s], peakPaths[(size_t)s]);
+	}
+
+	if (!analyzerDirty.isEmpty())
+		analyzerLayer.repaint(analyzerDirty.getSmallestIntegerContainer());
+
+	if (parametersChanged.compareAndSetBool(false, true) || audioProcessor.getSampleRate() != responseSampleRate)
+	{
+		//redesign, only the bands that changed are evaluated again and repainted
 		updateChain();
-		//signal a repaint
 	}
+}
 
-	repaint();
+//Before the host prepares the processor there is no rate to draw for, any sensible one will do
+static double getResponseRate(double sampleRate)
+{
+	return sampleRate > 0.0 ? sampleRate : 44100.0;
 }
 
 void ResponseCurveComponent::updateChain()
 {
-	//Peak chain
-	auto chainSettings = getChainSettings(audioProcessor.apvts);
-	auto peakCoefficient = makePeakFilter(chainSettings, audioProcessor.getSampleRate());
-	updateCoefficients(monoChain.get<ChainPossition::Peak>().coefficients, peakCoefficient);
+	//Peak and cut chains share one designer with the processor
+	auto sampleRate = audioProcessor.getSampleRate();
+
+	FilterCoefficientSet<double> coefficients;
+	makeFilterCoefficients(coefficients, getChainSettings(audioProcessor.apvts), getResponseRate(sampleRate));
+
+	auto rebuildAll = sampleRate != responseSampleRate || cosW.size() != (size_t)juce::jmax(0, getWidth());
+
+	if (rebuildAll)
+		updateResponseFrequencies(sampleRate);
+
+	auto sameCut = [](const CutCoefficients<double>& a, Slope slopeA, const CutCoefficients<double>& b, Slope slopeB)
+	{
+		return slopeA == slopeB && std::equal(a.begin(), a.begin() + slopeA + 1, b.begin());
+	};
+
+	const bool changed[numResponseBands]
+	{
+		rebuildAll || !sameCut(coefficients.lowCut, coefficients.lowCutSlope, responseCoefficients.lowCut, responseCoefficients.lowCutSlope),
+		rebuildAll || coefficients.peak != responseCoefficients.peak,
+		rebuildAll || !sameCut(coefficients.highCut, coefficients.highCutSlope, responseCoefficients.highCut, responseCoefficients.highCutSlope)
+	};
+
+	responseCoefficients = coefficients;
+
+	if (std::none_of(std::begin(changed), std::end(changed), [](bool c) { return c; }))
+		return;
+
+	for (int band = 0; band < numResponseBands; ++band)
+		if (changed[band])
+			updateBand(static_cast<ResponseBand>(band));
+
+	for (size_t i = 0; i < responseDecibels.size(); ++i)
+		responseDecibels[i] = bandDecibels[Band_LowCut][i] + bandDecibels[Band_Peak][i] + bandDecibels[Band_HighCut][i];
+
+	responseLayer.repaint();
+}
+
+void ResponseCurveComponent::updateResponseFrequencies(double sampleRate)
+{
+	using namespace juce;
+
+	responseSampleRate = sampleRate;
+
+	auto rate = getResponseRate(sampleRate);
+	auto w = (size_t)jmax(0, getWidth());
+
+	cosW.resize(w);
+	cos2W.resize(w);
+	bandPower.resize(w);
+	responseDecibels.resize(w);
+
+	for (auto& decibels : bandDecibels)
+		decibels.resize(w);
+
+	for (size_t i = 0; i < w; ++i)
+	{
+		auto freq = mapToLog10((double)i / (double)w, 20.0, 20000.0);
+		auto omega = MathConstants<double>::twoPi * freq / rate;
+
+		cosW[i] = std::cos(omega);
+		cos2W[i] = std::cos(2.0 * omega);
+	}
+}
+
+void ResponseCurveComponent::updateBand(ResponseBand band)
+{
+	std::fill(bandPower.begin(), bandPower.end(), 1.0);
+
+	auto multiply = [this](const BiquadCoefficients<double>& section)
+	{
+		FilterDesign::multiplyPowerResponse(section, cosW.data(), cos2W.data(), bandPower.data(), (int)bandPower.size());
+	};
 
-	//Cut chain
-	auto lowCutCoefficients = makeLowCutFilter(chainSettings, audioProcessor.getSampleRate());
-	auto highCutCoefficients = makeHighCutFilter(chainSettings, audioProcessor.getSampleRate());
+	switch (band)
+	{
+	case Band_LowCut:
+		for (int i = 0; i <= responseCoefficients.lowCutSlope; ++i)
+			multiply(responseCoefficients.lowCut[(size_t)i]);
+		break;
+	case Band_Peak:
+		multiply(responseCoefficients.peak);
+		break;
+	case Band_HighCut:
+		for (int i = 0; i <= responseCoefficients.highCutSlope; ++i)
+			multiply(responseCoefficients.highCut[(size_t)i]);
+		break;
+	default:
+		break;
+	}
+
+	//-200 dB floor, far below anything the curve shows
+	auto& decibels = bandDecibels[band];
 
-	updateCutFilter(monoChain.get<ChainPossition::LowCut>(), lowCutCoefficients, chainSettings.lowCutSlope);
-	updateCutFilter(monoChain.get<ChainPossition::HighCut>(), highCutCoefficients, chainSettings.highCutSlope);
+	for (size_t i = 0; i < decibels.size(); ++i)
+		decibels[i] = 10.0 * std::log10(juce::jmax(bandPower[i], 1.0e-20));
 }
 
 void ResponseCurveComponent::paint(juce::Graphics& g)
@@ -108,50 +344,33 @@ void ResponseCurveComponent::paint(juce::Graphics& g)
 	// (Our component is opaque, so we must completely fill the background with a solid colour)
 	g.fillAll(Colours::black);
 
+	//The grid, drawn once in resized
 	g.drawImage(background, getLocalBounds().toFloat());
+}
 
-	auto responseArea = getLocalBounds();
-
-	auto w = responseArea.getWidth();
-
-	auto& lowcut = monoChain.get<ChainPossition::LowCut>();
-	auto& peak = monoChain.get<ChainPossition::Peak>();
-	auto& highcut = monoChain.get<ChainPossition::HighCut>();
-
-	auto sampleRate = audioProcessor.getSampleRate();
-
-	std::vector<double> mags;
+void ResponseCurveComponent::paintAnalyzer(juce::Graphics& g)
+{
+	using namespace juce;
 
-	mags.resize(w);
+	//Left, right, mid and side
+	const Colour spectrumColours[numAnalyzerSpectra]{ Colours::aliceblue, Colours::lightcoral, Colours::khaki, Colours::mediumseagreen };
 
-	for (int i = 0; i < w; i++)
+	//The paths are laid out in the layer's own coordinates, so they are stroked as they are
+	for (int s = 0; s < numAnalyzerSpectra; ++s)
 	{
-		double mag = 1.f;
-		auto freq = mapToLog10((double)i / (double)w, 20.0, 20000.0);
+		g.setColour(spectrumColours[s]);
+		g.strokePath(analyzerPaths[(size_t)s], PathStrokeType(s < Spectrum_Mid ? 2.f : 1.f));
 
-		if (!monoChain.isBypassed<ChainPossition::Peak>())
-			mag *= peak.coefficients->getMagnitudeForFrequency(freq, sampleRate);
-
-		if (!lowcut.isBypassed<0>())
-			mag *= lowcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-		if (!lowcut.isBypassed<1>())
-			mag *= lowcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-		if (!lowcut.isBypassed<2>())
-			mag *= lowcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-		if (!lowcut.isBypassed<3>())
-			mag *= lowcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-
-		if (!highcut.isBypassed<0>())
-			mag *= highcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-		if (!highcut.isBypassed<1>())
-			mag *= highcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-		if (!highcut.isBypassed<2>())
-			mag *= highcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-		if (!highcut.isBypassed<3>())
-			mag *= highcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-
-		mags[i] = Decibels::gainToDecibels(mag);
+		g.setColour(spectrumColours[s].withAlpha(0.4f));
+		g.strokePath(peakPaths[(size_t)s], PathStrokeType(1.f));
 	}
+}
+
+void ResponseCurveComponent::paintResponse(juce::Graphics& g)
+{
+	using namespace juce;
+
+	auto responseArea = responseLayer.getLocalBounds();
 
 	Path responseCurve;
 
@@ -163,17 +382,16 @@ void ResponseCurveComponent::paint(juce::Graphics& g)
 		return jmap(input, -24.0, 24.0, outputMin, outputMax);
 	};
 
-	responseCurve.startNewSubPath(responseArea.getX(), map(mags.front()));
-
-	for (size_t i = 0; i < mags.size(); i++)
+	//Cached by updateChain, only mapped to the screen here
+	if (!responseDecibels.empty())
 	{
-		responseCurve.lineTo(responseArea.getX() + i, map(mags[i]));
-	}
+		responseCurve.startNewSubPath(responseArea.getX(), map(responseDecibels.front()));
 
-	leftPanelFFTPath.applyTransform(AffineTransform().translation(responseArea.getX(), responseArea.getY()));
-
-	g.setColour(Colours::aliceblue);
-	g.strokePath(leftPanelFFTPath, PathStrokeType(2.f));
+		for (size_t i = 0; i < responseDecibels.size(); i++)
+		{
+			responseCurve.lineTo(responseArea.getX() + i, map(responseDecibels[i]));
+		}
+	}
 
 	g.setColour(Colours::antiquewhite);
 	g.drawRoundedRectangle(responseArea.toFloat(), 4.f, 1.f);
@@ -185,6 +403,13 @@ void ResponseCurveComponent::paint(juce::Graphics& g)
 void ResponseCurveComponent::resized()
 {
 	using namespace juce;
+
+	analysisWidth = (float)getWidth();
+	analysisHeight = (float)getHeight();
+
+	analyzerLayer.setBounds(getLocalBounds());
+	responseLayer.setBounds(getLocalBounds());
+
 	background = Image(Image::PixelFormat::RGB, getWidth(), getHeight(), true);
 
 	Graphics g(background);
@@ -214,11 +439,92 @@ void ResponseCurveComponent::resized()
 
 		g.drawHorizontalLine(y, 0.f, getWidth());
 	}
+
+	//The cached curve has one point per pixel column
+	updateChain();
+}
+
+LoadMeterOverlay::LoadMeterOverlay(SoundWizardAudioProcessor& p, const ResponseCurveComponent& r) : audioProcessor(p), responseCurve(r)
+{
+	auto snapshot = audioProcessor.loadMeter.getSnapshot();
+	overrunsBase = snapshot.overruns;
+	droppedBase = getDroppedBlocks();
+	fftDroppedBase = responseCurve.getFFTQueueStats().dropped;
+	pathDroppedBase = responseCurve.getPathQueueStats().dropped;
+
+	startTimerHz(4);
+}
+
+juce::uint32 LoadMeterOverlay::getDroppedBlocks() const
+{
+	return audioProcessor.leftChanelQueue.getNumDroppedBlocks() + audioProcessor.rightChanelQueue.getNumDroppedBlocks();
+}
+
+void LoadMeterOverlay::timerCallback()
+{
+	auto snapshot = audioProcessor.loadMeter.getSnapshot();
+
+	auto percent = [](float load) { return juce::String(load * 100.f, 1) + "%"; };
+
+	auto newLoadText = "DSP " + percent(snapshot.current) + "  avg " + percent(snapshot.average) + "  worst " + percent(snapshot.worst);
+
+	auto newStageText = "coeff " + percent(snapshot.stages[LoadMeter::Stage_Coefficients])
+		+ "  filter " + percent(snapshot.stages[LoadMeter::Stage_Filtering])
+		+ "  analyzer " + percent(snapshot.stages[LoadMeter::Stage_Analyzer])
+		+ "  overruns " + juce::String(snapshot.overruns - overrunsBase)
+		+ "  drops " + juce::String(getDroppedBlocks() - droppedBase);
+
+	auto describeQueue = [](const char* name, const QueueStats& stats, int dropped)
+	{
+		return juce::String(name) + " drops " + juce::String(stats.dropped - dropped)
+			+ "  high " + juce::String(stats.highWater) + "  lag " + juce::String(stats.consumerLag);
+	};
+
+	auto newQueueText = describeQueue("fft", responseCurve.getFFTQueueStats(), fftDroppedBase)
+		+ "  " + describeQueue("paths", responseCurve.getPathQueueStats(), pathDroppedBase);
+
+	//Nothing to paint while the numbers hold still
+	if (newLoadText == loadText && newStageText == stageText && newQueueText == queueText)
+		return;
+
+	loadText = newLoadText;
+	stageText = newStageText;
+	queueText = newQueueText;
+	repaint();
+}
+
+void LoadMeterOverlay::paint(juce::Graphics& g)
+{
+	using namespace juce;
+
+	g.setColour(Colours::black.withAlpha(0.6f));
+	g.fillRect(getLocalBounds());
+
+	auto bounds = getLocalBounds().reduced(4, 2);
+	auto lineHeight = bounds.getHeight() / 3;
+
+	g.setColour(Colours::white);
+	g.setFont(11.f);
+	g.drawFittedText(loadText, bounds.removeFromTop(lineHeight), Justification::centredRight, 1);
+	g.drawFittedText(stageText, bounds.removeFromTop(lineHeight), Justification::centredRight, 1);
+	g.drawFittedText(queueText, bounds, Justification::centredRight, 1);
+}
+
+void LoadMeterOverlay::mouseDown(const juce::MouseEvent&)
+{
+	audioProcessor.loadMeter.resetWorst();
+
+	overrunsBase = audioProcessor.loadMeter.getSnapshot().overruns;
+	droppedBase = getDroppedBlocks();
+	fftDroppedBase = responseCurve.getFFTQueueStats().dropped;
+	pathDroppedBase = responseCurve.getPathQueueStats().dropped;
+
+	timerCallback();
 }
 
 std::vector<juce::Component*> SoundWizardAudioProcessorEditor::getComps()
 {
-	return { &peakFreqSlider, &peakGainSlider, &peakQualitySlider, &lowCutFreqSlider, &highCutFreqSlider, &lowCutSlopeSlider, &highCutSlopeSlider, &responseCurveComponent };
+	return { &peakFreqSlider, &peakGainSlider, &peakQualitySlider, &lowCutFreqSlider, &highCutFreqSlider, &lowCutSlopeSlider, &highCutSlopeSlider, &responseCurveComponent, &loadMeterOverlay };
 }
 
 //==============================================================================
@@ -231,7 +537,8 @@ SoundWizardAudioProcessorEditor::SoundWizardAudioProcessorEditor(SoundWizardAudi
 	highCutFreqSliderAttachment(audioProcessor.apvts, "HighCut Freq", highCutFreqSlider),
 	lowCutSlopeSliderAttachment(audioProcessor.apvts, "LowCut Slope", lowCutSlopeSlider),
 	highCutSlopeSliderAttachment(audioProcessor.apvts, "HighCut Slope", highCutSlopeSlider),
-	responseCurveComponent(audioProcessor)
+	responseCurveComponent(audioProcessor),
+	loadMeterOverlay(audioProcessor, responseCurveComponent)
 {
 	// Make sure that before the constructor has finished, you've set the
 	// editor's size to whatever you need it to be.
@@ -266,6 +573,9 @@ void SoundWizardAudioProcessorEditor::resized()
 
 	responseCurveComponent.setBounds(responseArea);
 
+	//Top right corner of the display, in front of it as it comes later in getComps
+	loadMeterOverlay.setBounds(responseArea.withLeft(responseArea.getRight() - 300).withHeight(44));
+
 	auto lowCutArea = bounds.removeFromLeft(bounds.getWidth() * 0.33);
 	auto highCutArea = bounds.removeFromRight(bounds.getWidth() * 0.5);
 
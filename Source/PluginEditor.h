@@ -10,6 +10,7 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "AnalyzerWorker.h"
 
 enum FFTOrder
 {
@@ -18,51 +19,96 @@ enum FFTOrder
     order8192 = 13
 };
 
+//The spectra one stereo FFT produces
+enum AnalyzerSpectrum
+{
+    Spectrum_Left,
+    Spectrum_Right,
+    Spectrum_Mid,
+    Spectrum_Side,
+    numAnalyzerSpectra
+};
+
+//How much consecutive analysis windows share, the hop is the rest of the window
+enum AnalyzerOverlap
+{
+    Overlap_50,
+    Overlap_75,
+    Overlap_87_5
+};
+
+//Time constant of the exponential average over FFT frames
+enum AnalyzerAveraging
+{
+    Averaging_Off,
+    Averaging_Fast,
+    Averaging_Medium,
+    Averaging_Slow
+};
+
 template<typename BlockType>
 struct FFTDataGenerator
 {
     /**
      produces the FFT data from an audio buffer.
+     Left and right are packed into the real and imaginary parts of one complex FFT and split afterwards,
+     so both channels cost a single transform. Mid and side follow from them by linearity.
+     'audioData' is a ring of one FFT size whose oldest sample is at 'oldestSample'.
      */
-    void produceFFTDataForRendering(const juce::AudioBuffer<float>& audioData, const float negativeInfinity)
+    void produceFFTDataForRendering(const juce::AudioBuffer<float>& audioData, int oldestSample, const float negativeInfinity)
     {
         const auto fftSize = getFFTSize();
         
-        fftData.assign(fftData.size(), 0);
-        auto* readIndex = audioData.getReadPointer(0);
-        std::copy(readIndex, readIndex + fftSize, fftData.begin());
+        auto* left = audioData.getReadPointer(0);
+        auto* right = audioData.getReadPointer(juce::jmin(1, audioData.getNumChannels() - 1));
+
+        //Unwrapping the ring is the copy the window needs anyway
+        auto numToEnd = fftSize - oldestSample;
+
+        std::copy(left + oldestSample, left + fftSize, windowedLeft.begin());
+        std::copy(left, left + oldestSample, windowedLeft.begin() + numToEnd);
+        std::copy(right + oldestSample, right + fftSize, windowedRight.begin());
+        std::copy(right, right + oldestSample, windowedRight.begin() + numToEnd);
         
         // first apply a windowing function to our data
-        window->multiplyWithWindowingTable (fftData.data(), fftSize);       // [1]
+        window->multiplyWithWindowingTable (windowedLeft.data(), fftSize);       // [1]
+        window->multiplyWithWindowingTable (windowedRight.data(), fftSize);
         
+        for( int i = 0; i < fftSize; ++i )
+            packed[i] = { windowedLeft[i], windowedRight[i] };
+
         // then render our FFT data..
-        forwardFFT->performFrequencyOnlyForwardTransform (fftData.data());  // [2]
+        forwardFFT->perform (packed.data(), spectrum.data(), false);            // [2]
         
         int numBins = (int)fftSize / 2;
-        
-        //normalize the fft values.
-        for( int i = 0; i < numBins; ++i )
+
+        for( int k = 0; k < numBins; ++k )
         {
-            auto v = fftData[i];
-//            fftData[i] /= (float) numBins;
-            if( !std::isinf(v) && !std::isnan(v) )
-            {
-                v /= float(numBins);
-            }
-            else
-            {
-                v = 0.f;
-            }
-            fftData[i] = v;
+            //Z[k] = L[k] + jR[k], and the spectra of real signals are conjugate symmetric
+            auto z = spectrum[k];
+            auto zMirror = std::conj(spectrum[(fftSize - k) & (fftSize - 1)]);
+
+            auto l = (z + zMirror) * 0.5f;
+            auto r = (z - zMirror) * Complex(0.f, -0.5f);
+
+            power[Spectrum_Left][k] = std::norm(l);
+            power[Spectrum_Right][k] = std::norm(r);
+            power[Spectrum_Mid][k] = std::norm((l + r) * 0.5f);
+            power[Spectrum_Side][k] = std::norm((l - r) * 0.5f);
         }
-        
-        //convert them to decibels
-        for( int i = 0; i < numBins; ++i )
+
+        for( int s = 0; s < numAnalyzerSpectra; ++s )
         {
-            fftData[i] = juce::Decibels::gainToDecibels(fftData[i], negativeInfinity);
+            //The slot swapped back by the last push is already this size, so this never allocates
+            fftData[s].resize(fftSize * 2);
+
+            postProcess(s, numBins, negativeInfinity);
         }
-        
-        fftDataQueue.push(fftData);
+
+        isFirstFrame = false;
+
+        for( int s = 0; s < numAnalyzerSpectra; ++s )
+            fftDataQueues[s].push(fftData[s]);
     }
     
     void changeOrder(FFTOrder newOrder)
@@ -77,23 +123,120 @@ struct FFTDataGenerator
         forwardFFT = std::make_unique<juce::dsp::FFT>(order);
         window = std::make_unique<juce::dsp::WindowingFunction<float>>(fftSize, juce::dsp::WindowingFunction<float>::blackmanHarris);
         
-        fftData.clear();
-        fftData.resize(fftSize * 2, 0);
+        windowedLeft.assign(fftSize, 0);
+        windowedRight.assign(fftSize, 0);
+        packed.assign(fftSize, {});
+        spectrum.assign(fftSize, {});
+
+        isFirstFrame = true;
+
+        for( int s = 0; s < numAnalyzerSpectra; ++s )
+        {
+            power[s].assign(fftSize / 2, 0);
+            average[s].assign(fftSize / 2, 0);
+            peak[s].assign(fftSize / 2, 0);
+
+            fftData[s].clear();
+            fftData[s].resize(fftSize * 2, 0);
 
-        fftDataQueue.prepare(fftData.size());
+            fftDataQueues[s].prepare(fftData[s]);
+        }
+    }
+    /*
+     frameSeconds is the time between two FFTs. The average follows the spectrum with a time constant of averagingSeconds,
+     0 for none, and the peak hold trace falls by peakDecayDbPerSecond.
+     */
+    void setTiming(float frameSeconds, float averagingSeconds, float peakDecayDbPerSecond)
+    {
+        averagingCoefficient = averagingSeconds > 0.f ? 1.f - std::exp(-frameSeconds / averagingSeconds) : 1.f;
+        peakDecay = peakDecayDbPerSecond * frameSeconds;
     }
     //==============================================================================
     int getFFTSize() const { return 1 << order; }
-    int getNumAvailableFFTDataBlocks() const { return fftDataQueue.getNumAvailableForReading(); }
+    FFTOrder getOrder() const { return order; }
+    int getNumAvailableFFTDataBlocks(AnalyzerSpectrum s) const { return fftDataQueues[s].getNumAvailableForReading(); }
     //==============================================================================
-    bool getFFTData(BlockType& fftData) { return fftDataQueue.pull(fftData); }
+    bool getFFTData(AnalyzerSpectrum s, BlockType& fftData) { return fftDataQueues[s].pull(fftData); }
+    QueueStats getQueueStats(AnalyzerSpectrum s) const { return fftDataQueues[s].getStats(); }
 private:
+    using Complex = juce::dsp::Complex<float>;
+
     FFTOrder order;
-    BlockType fftData;
+    std::array<BlockType, numAnalyzerSpectra> fftData;
     std::unique_ptr<juce::dsp::FFT> forwardFFT;
     std::unique_ptr<juce::dsp::WindowingFunction<float>> window;
+
+    std::vector<float> windowedLeft, windowedRight;
+    std::vector<Complex> packed, spectrum;
+
+    //Per spectrum and bin, the squared magnitude of this frame, the running average and the peak hold in decibels
+    std::array<std::vector<float>, numAnalyzerSpectra> power, average, peak;
+    bool isFirstFrame = true;
+    float averagingCoefficient = 1.f, peakDecay = 0.f;
+
+    /*
+     log2 to within 0.005, from the exponent bits and a quadratic over the mantissa.
+     Only for positive, finite x.
+     */
+    static float fastLog2(float x)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+
+        //The quadratic runs from 1 to 2 over the mantissa, so the exponent is taken one lower
+        auto exponent = (float)((int)(bits >> 23) - 128);
+
+        bits = (bits & 0x007fffffu) | 0x3f800000u;
+
+        float mantissa;
+        std::memcpy(&mantissa, &bits, sizeof(mantissa));
+
+        return exponent + (-0.34484843f * mantissa + 2.02466578f) * mantissa - 0.67487759f;
+    }
+
+    /*
+     Normalises, converts to decibels, averages and updates the peak hold of one spectrum in a single pass.
+     The loop has no branches or calls left after inlining, so the compiler vectorises it.
+     The averaged bins go into the first numBins values of the block and the peak hold trace right after them.
+     */
+    void postProcess(int s, int numBins, float negativeInfinity)
+    {
+        //|X| / numBins in decibels is 10 log10 of the power over numBins squared
+        const auto scale = 1.f / float(numBins * numBins);
+        const auto minPower = std::pow(10.f, negativeInfinity / 10.f);
+        const auto maxPower = 1.0e30f;
+        //10 log10(2), the decibels each doubling of power adds
+        const auto decibelsPerPowerDoubling = 3.01029996f;
+
+        const auto alpha = isFirstFrame ? 1.f : averagingCoefficient;
+        const auto decay = isFirstFrame ? 0.f : peakDecay;
+        const auto peakFloor = isFirstFrame ? negativeInfinity : -std::numeric_limits<float>::max();
+
+        auto* in = power[s].data();
+        auto* avg = average[s].data();
+        auto* hold = peak[s].data();
+        auto* out = fftData[s].data();
+
+        for( int k = 0; k < numBins; ++k )
+        {
+            //NaN and inf fail both comparisons and fall to the floor
+            auto p = in[k] * scale;
+            p = (p > minPower && p < maxPower) ? p : minPower;
+
+            auto level = decibelsPerPowerDoubling * fastLog2(p);
+
+            avg[k] += alpha * (level - avg[k]);
+
+            auto held = hold[k] - decay;
+            held = held > peakFloor ? held : peakFloor;
+            hold[k] = level > held ? level : held;
+
+            out[k] = avg[k];
+            out[numBins + k] = hold[k];
+        }
+    }
     
-    Queue<BlockType> fftDataQueue;
+    std::array<Queue<BlockType>, numAnalyzerSpectra> fftDataQueues;
 };
 
 template<typename PathType>
@@ -102,7 +245,7 @@ struct AnalyzerPathGenerator
     /*
      converts 'renderData[]' into a juce::Path
      */
-    void generatePath(const std::vector<float>& renderData,
+    void generatePath(const float* renderData,
                       juce::Rectangle<float> fftBounds,
                       int fftSize,
                       float binWidth,
@@ -112,10 +255,13 @@ struct AnalyzerPathGenerator
         auto bottom = fftBounds.getHeight();
         auto width = fftBounds.getWidth();
 
-        int numBins = (int)fftSize / 2;
+        if( width != mappedWidth || fftSize != mappedFFTSize || binWidth != mappedBinWidth )
+            buildColumnMap(width, fftSize, binWidth);
 
-        PathType p;
-        p.preallocateSpace(3 * (int)fftBounds.getWidth());
+        //Reuses whatever storage the last push swapped back
+        auto& p = path;
+        p.clear();
+        p.preallocateSpace(3 * ((int)columns.size() + 1));
 
         auto map = [bottom, top, negativeInfinity](float v)
         {
@@ -124,28 +270,25 @@ struct AnalyzerPathGenerator
                               float(bottom+10),   top);
         };
 
-        auto y = map(renderData[0]);
-
-//        jassert( !std::isnan(y) && !std::isinf(y) );
-        if( std::isnan(y) || std::isinf(y) )
-            y = bottom;
-        
-        p.startNewSubPath(0, y);
-
-        const int pathResolution = 2; //you can draw line-to's every 'pathResolution' pixels.
+        auto started = false;
 
-        for( int binNum = 1; binNum < numBins; binNum += pathResolution )
+        for( const auto& column : columns )
         {
-            y = map(renderData[binNum]);
+            //The loudest bin is what the column has to show
+            auto level = *std::max_element(renderData + column.firstBin, renderData + column.endBin);
+            auto y = map(level);
 
-//            jassert( !std::isnan(y) && !std::isinf(y) );
+            if( std::isnan(y) || std::isinf(y) )
+                continue;
 
-            if( !std::isnan(y) && !std::isinf(y) )
+            if( started )
+            {
+                p.lineTo(column.x, y);
+            }
+            else
             {
-                auto binFreq = binNum * binWidth;
-                auto normalizedBinX = juce::mapFromLog10(binFreq, 20.f, 20000.f);
-                int binX = std::floor(normalizedBinX * width);
-                p.lineTo(binX, y);
+                p.startNewSubPath(column.x, y);
+                started = true;
             }
         }
 
@@ -161,8 +304,59 @@ struct AnalyzerPathGenerator
     {
         return pathQueue.pull(path);
     }
+
+    QueueStats getQueueStats() const { return pathQueue.getStats(); }
 private:
+    //Bins [firstBin, endBin) drawn as one vertex at x
+    struct Column
+    {
+        int firstBin, endBin;
+        float x;
+    };
+
+    PathType path;
     Queue<PathType> pathQueue;
+
+    std::vector<Column> columns;
+    float mappedWidth = 0.f, mappedBinWidth = 0.f;
+    int mappedFFTSize = 0;
+
+    /*
+     Groups the bins by the pixel column they land in, so a path has at most one vertex per column.
+     Where bins are wider than a pixel, at the low end, each keeps its exact position and the line interpolates between them.
+     */
+    void buildColumnMap(float width, int fftSize, float binWidth)
+    {
+        mappedWidth = width;
+        mappedFFTSize = fftSize;
+        mappedBinWidth = binWidth;
+
+        columns.clear();
+
+        if( width <= 0.f || binWidth <= 0.f )
+            return;
+
+        int numBins = (int)fftSize / 2;
+
+        for( int binNum = 1; binNum < numBins; ++binNum )
+        {
+            auto x = juce::mapFromLog10(binNum * binWidth, 20.f, 20000.f) * width;
+            auto column = std::floor(x);
+
+            if( !columns.empty() && std::floor(columns.back().x) == column )
+            {
+                columns.back().endBin = binNum + 1;
+                columns.back().x = column;
+                continue;
+            }
+
+            //One vertex past the right edge carries the line out of view
+            if( !columns.empty() && columns.back().x > width )
+                break;
+
+            columns.push_back({ binNum, binNum + 1, x });
+        }
+    }
 };
 
 
@@ -173,9 +367,28 @@ struct RotarySlyder : juce::Slider
 	}
 };
 
+//One layer of the response display, painted by its owner but repainted on its own
+struct DisplayLayer : juce::Component
+{
+	explicit DisplayLayer(std::function<void(juce::Graphics&)> painter) : paintLayer(std::move(painter))
+	{
+		setInterceptsMouseClicks(false, false);
+	}
+
+	void paint(juce::Graphics& g) override { paintLayer(g); }
+
+private:
+	std::function<void(juce::Graphics&)> paintLayer;
+};
+
+/*
+ The grid is painted by the component itself from a cached image, the response curve and the analyzer traces are
+ layers on top of it. Each layer is repainted only where its content changed, so an idle editor paints nothing.
+ */
 struct ResponseCurveComponent : juce::Component,
 	juce::AudioProcessorParameter::Listener,
-	juce::Timer
+	juce::Timer,
+	AnalyzerClient
 {
 	ResponseCurveComponent(SoundWizardAudioProcessor&);
 	~ResponseCurveComponent();
@@ -186,26 +399,102 @@ struct ResponseCurveComponent : juce::Component,
 
 	void timerCallback() override;
 
+	void runAnalysis() override;
+
+	//Any thread, drops add up over every spectrum and the high water and lag are the worst of them
+	QueueStats getFFTQueueStats() const;
+	QueueStats getPathQueueStats() const;
+
 	void paint(juce::Graphics& graphic) override;
 	void resized() override;
 
 private:
 	SoundWizardAudioProcessor& audioProcessor;
 	juce::Atomic<bool> parametersChanged {false};
-	MonoChain monoChain;
 	void updateChain();
 
+	//The response curve in decibels per pixel column, kept per band so a change only recomputes its own band
+	enum ResponseBand
+	{
+		Band_LowCut,
+		Band_Peak,
+		Band_HighCut,
+		numResponseBands
+	};
+
+	FilterCoefficientSet<double> responseCoefficients;
+	double responseSampleRate = 0.0;
+
+	std::vector<double> cosW, cos2W, bandPower;
+	std::array<std::vector<double>, numResponseBands> bandDecibels;
+	std::vector<double> responseDecibels;
+
+	void updateResponseFrequencies(double sampleRate);
+	void updateBand(ResponseBand band);
+
 	juce::Image background;
 
-	SingleChannelSampleQueue<SoundWizardAudioProcessor::BlockType>* leftChannelQueue;
+	SingleChannelSampleQueue* leftChannelQueue;
+	SingleChannelSampleQueue* rightChannelQueue;
+
+	//Circular, one FFT size long, left in channel 0 and right in channel 1
+	juce::AudioBuffer<float> analysisBuffer;
+	int analysisWritePosition = 0;
+	int samplesSinceLastFFT = 0;
+
+    //Owned by the worker, which builds a new one whole when the resolution changes
+    std::unique_ptr<FFTDataGenerator<std::vector<float>>> stereoFFTDataGenerator;
+    std::atomic<float>* analyzerResolutionParameter = nullptr;
+    std::atomic<float>* analyzerOverlapParameter = nullptr;
+    std::atomic<float>* analyzerAveragingParameter = nullptr;
+
+    void changeAnalyzerOrder(FFTOrder newOrder);
 
-	juce::AudioBuffer<float> monoBuffer;
+    //Copied out by the worker after every pass, the generator it reads them from can be replaced at any time
+    std::atomic<int> fftQueueDropped { 0 }, fftQueueHighWater { 0 }, fftQueueLag { 0 };
+    int retiredFFTQueueDrops = 0;
 
-    FFTDataGenerator<std::vector<float>> leftChannelFFTDataGenerator;
+    void publishFFTQueueStats();
+
+    std::array<AnalyzerPathGenerator<juce::Path>, numAnalyzerSpectra> pathProducers, peakPathProducers;
+
+    //Pulled into and swapped back, so it keeps the generator's size
+    std::vector<float> fftData;
+
+    std::array<juce::Path, numAnalyzerSpectra> analyzerPaths, peakPaths;
+
+    //Size the worker lays the paths out for, written by resized()
+    std::atomic<float> analysisWidth { 0.f }, analysisHeight { 0.f };
+
+    //The response layer is buffered, so analyzer repaints underneath it only composite its image
+    DisplayLayer analyzerLayer { [this](juce::Graphics& g) { paintAnalyzer(g); } };
+    DisplayLayer responseLayer { [this](juce::Graphics& g) { paintResponse(g); } };
+
+    void paintAnalyzer(juce::Graphics& g);
+    void paintResponse(juce::Graphics& g);
+
+    juce::SharedResourcePointer<AnalyzerWorker> analyzerWorker;
+};
+//DSP load of the processor, the blocks it could not keep up with and the analyzer queues, a click clears the worst case and the counts
+struct LoadMeterOverlay : juce::Component,
+	juce::Timer
+{
+	LoadMeterOverlay(SoundWizardAudioProcessor&, const ResponseCurveComponent&);
+
+	void timerCallback() override;
+	void paint(juce::Graphics& g) override;
+	void mouseDown(const juce::MouseEvent&) override;
+
+private:
+	SoundWizardAudioProcessor& audioProcessor;
+	const ResponseCurveComponent& responseCurve;
 
-    AnalyzerPathGenerator<juce::Path> pathProducer;
+	//Counts are running totals in the processor and the analyzer, shown from the last click on
+	juce::uint32 overrunsBase = 0, droppedBase = 0;
+	int fftDroppedBase = 0, pathDroppedBase = 0;
+	juce::String loadText, stageText, queueText;
 
-    juce::Path leftPanelFFTPath;
+	juce::uint32 getDroppedBlocks() const;
 };
 //==============================================================================
 /**
@@ -236,6 +525,7 @@ private:
 	std::vector<juce::Component*> getComps();
 
 	ResponseCurveComponent responseCurveComponent ;
+	LoadMeterOverlay loadMeterOverlay;
 
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SoundWizardAudioProcessorEditor)
 };
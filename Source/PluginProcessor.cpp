@@ -22,10 +22,27 @@ SoundWizardAudioProcessor::SoundWizardAudioProcessor()
 	)
 #endif
 {
+	updateGridParameter = apvts.getRawParameterValue("Update Grid");
+	oversamplingParameter = apvts.getRawParameterValue("Oversampling");
+	oversamplingModeParameter = apvts.getRawParameterValue("Oversampling Mode");
+	filterModeParameter = apvts.getRawParameterValue("Filter Mode");
+	filterModeChoiceParameter = apvts.getParameter("Filter Mode");
+	firLengthParameter = apvts.getParameter("FIR Length");
+	firPartitionParameter = apvts.getParameter("FIR Partition");
+	firLengthValue = apvts.getRawParameterValue("FIR Length");
+	firPartitionValue = apvts.getRawParameterValue("FIR Partition");
+
+	for (auto* param : getParameters())
+		param->addListener(this);
 }
 
 SoundWizardAudioProcessor::~SoundWizardAudioProcessor()
 {
+	kernelDesignThread.stopThread(1000);
+	coefficientDesignThread.stopThread(1000);
+
+	for (auto* param : getParameters())
+		param->removeListener(this);
 }
 
 //==============================================================================
@@ -63,7 +80,7 @@ bool SoundWizardAudioProcessor::isMidiEffect() const
 
 double SoundWizardAudioProcessor::getTailLengthSeconds() const
 {
-	return 0.0;
+	return tailLengthSeconds.load();
 }
 
 int SoundWizardAudioProcessor::getNumPrograms()
@@ -96,28 +113,59 @@ void SoundWizardAudioProcessor::prepareToPlay(double sampleRate, int samplesPerB
 	// Use this method as the place to do any pre-playback
 	// initialisation that you need..
 
-//Prepare two chanels output
+//Prepare every chanel of the current layout
 	juce::dsp::ProcessSpec spec{};
 
 	spec.maximumBlockSize = samplesPerBlock;
 
-	spec.numChannels = 1;
+	spec.numChannels = (juce::uint32)juce::jmax(getTotalNumInputChannels(), getTotalNumOutputChannels());
 
 	spec.sampleRate = sampleRate;
 
-	leftChain.prepare(spec);
-	rightChain.prepare(spec);
+	//The designers must not touch the convolver or the ramps while they are reallocated
+	kernelDesignThread.stopThread(1000);
+	coefficientDesignThread.stopThread(1000);
+	designPending = false;
+	kernelDesignPending = false;
+
+	//Whatever size the designer was working towards is started over at the current one
+	kernelNumChannels = (int)spec.numChannels;
+	kernelSampleRate = sampleRate;
+	kernelConvolver = activeConvolver = 0;
+	pendingConvolver = -1;
+
+	linearPhaseConvolvers[0].prepare(kernelNumChannels, getFirKernelOrder(), getFirPartitionOrder());
+
+	updateLinearPhaseKernel(true);
+	getActiveConvolver().reset();
+
+	if (isUsingDoublePrecision())
+		prepareFilters<double>(spec);
+	else
+		prepareFilters<float>(spec);
+
+	//Hosts read the latency as soon as prepareToPlay returns, it cannot wait for the message thread
+	cancelPendingUpdate();
+	setLatencySamples(runningLatencySamples.load());
 
-	updateFilters();
+	kernelDesignThread.startThread();
+	coefficientDesignThread.startThread();
 
 	leftChanelQueue.prepare(samplesPerBlock);
 	rightChanelQueue.prepare(samplesPerBlock);
+
+	analyzerSilenceLimit = maxAnalyzerWindow + (int)std::ceil(analyzerDecaySeconds * sampleRate);
+	analyzerSilentSamples = 0;
+
+	loadMeter.prepare(sampleRate);
 }
 
 void SoundWizardAudioProcessor::releaseResources()
 {
 	// When playback stops, you can use this as an opportunity to free up any
 	// spare memory, etc.
+	kernelDesignThread.stopThread(1000);
+	coefficientDesignThread.stopThread(1000);
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -127,12 +175,10 @@ bool SoundWizardAudioProcessor::isBusesLayoutSupported(const BusesLayout& layout
 	juce::ignoreUnused(layouts);
 	return true;
 #else
-	// This is the place where you check if the layout is supported.
-	// In this template code we only support mono or stereo.
-	// Some plugin hosts, such as certain GarageBand versions, will only
-	// load plugins that support stereo bus layouts.
-	if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-		&& layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+	// Any layout works, from mono up to immersive and ambisonic ones,
+	// since the chain packs however many channels there are into SIMD lanes.
+	if (layouts.getMainOutputChannelSet().isDisabled()
+		|| layouts.getMainOutputChannels() > maxChannels)
 		return false;
 
 	// This checks if the input layout matches the output layout
@@ -147,8 +193,60 @@ bool SoundWizardAudioProcessor::isBusesLayoutSupported(const BusesLayout& layout
 #endif
 
 void SoundWizardAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+	processSamples(buffer);
+}
+
+void SoundWizardAudioProcessor::processBlock(juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+	processSamples(buffer);
+}
+
+template<typename SampleType>
+static bool isSilent(const juce::dsp::AudioBlock<SampleType>& block)
+{
+	auto range = block.findMinAndMax();
+	return juce::jmax(-range.getStart(), range.getEnd()) < (SampleType)FilterDesign::silenceThreshold;
+}
+
+template<typename SampleType>
+void SoundWizardAudioProcessor::prepareFilters(const juce::dsp::ProcessSpec& spec)
+{
+	getFilterChain<SampleType>().prepare(spec);
+
+	designSampleRate = spec.sampleRate;
+	designBlockSize = (int)spec.maximumBlockSize;
+	designNumChannels = (size_t)spec.numChannels;
+	designDoublePrecision = std::is_same_v<SampleType, double>;
+
+	//Enough steps for a whole ramp on the finest grid
+	auto smoothingSamples = (int)std::ceil(smoothingTimeSeconds * spec.sampleRate);
+	auto maxSteps = smoothingSamples / getUpdateGridSize(G_16) + 2;
+
+	CoefficientRamp<SampleType> prototype;
+	prototype.steps.resize((size_t)maxSteps);
+	prototype.stepTailSeconds.resize((size_t)maxSteps);
+	getRampExchange<SampleType>().reset(prototype);
+
+	//Start from the current values without ramping, designed right here while the designer thread is stopped
+	rampSettings.reset(spec.sampleRate, smoothingTimeSeconds);
+	rampSettings.setCurrentAndTargetSettings(getChainSettings(apvts));
+	rampStartSample = 0;
+	processedSamples = 0;
+
+	designCoefficientRamp<SampleType>(true);
+	pullCoefficientRamp<SampleType>(true);
+	updateFilterMode<SampleType>(true);
+
+	applyRampStep(getRampExchange<SampleType>().getReadSlot(), 0);
+}
+
+template<typename SampleType>
+void SoundWizardAudioProcessor::processSamples(juce::AudioBuffer<SampleType>& buffer)
 {
 	juce::ScopedNoDenormals noDenormals;
+	loadMeter.beginBlock();
+
 	auto totalNumInputChannels = getTotalNumInputChannels();
 	auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -161,24 +259,405 @@ void SoundWizardAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, j
 	for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
 		buffer.clear(i, 0, buffer.getNumSamples());
 
-	//Update coeffitients
-	updateFilters();
+	pullCoefficientRamp<SampleType>(false);
+
+	juce::dsp::AudioBlock<SampleType> block(buffer);
+
+	updateFilterMode<SampleType>(false);
+
+	//Clearing, ramp pickups and mode switches count as coefficient work
+	loadMeter.mark(LoadMeter::Stage_Coefficients);
+
+	auto numSamples = (int)block.getNumSamples();
+	auto blockStart = processedSamples.load();
+
+	if (activeFilterMode == FM_LinearPhaseFIR)
+	{
+		getActiveConvolver().process(juce::dsp::ProcessContextReplacing<SampleType>(block));
+		loadMeter.mark(LoadMeter::Stage_Filtering);
+	}
+	else
+	{
+		//Steps through the ramp the designer laid out, splitting the block wherever the next step starts
+		const auto& ramp = getRampExchange<SampleType>().getReadSlot();
+
+		for (int start = 0; start < numSamples;)
+		{
+			auto position = blockStart + start;
+			auto index = ramp.getStepIndex(position);
+
+			if (index != activeRampStep)
+			{
+				applyRampStep(ramp, index);
+				loadMeter.mark(LoadMeter::Stage_Coefficients);
+			}
+
+			auto numInStep = numSamples - start;
+
+			if (index < ramp.numSteps - 1)
+				numInStep = (int)juce::jmin((juce::int64)numInStep, ramp.getStepEnd(index) - position);
+
+			auto subBlock = block.getSubBlock((size_t)start, (size_t)numInStep);
+			processFilters(subBlock);
+			loadMeter.mark(LoadMeter::Stage_Filtering);
+
+			start += numInStep;
+		}
+	}
+
+	processedSamples = blockStart + numSamples;
+
+	//Silence keeps going to the analyzer until the averaged and peak traces have fallen to the floor,
+	//after that more of it would not change the display
+	//Capped just past the limit, so hours of silence cannot overflow it
+	analyzerSilentSamples = isSilent(block) ? juce::jmin(analyzerSilentSamples + buffer.getNumSamples(), analyzerSilenceLimit + 1) : 0;
+
+	if (analyzerSilentSamples <= analyzerSilenceLimit)
+	{
+		leftChanelQueue.update(buffer);
+		rightChanelQueue.update(buffer);
+	}
+
+	loadMeter.mark(LoadMeter::Stage_Analyzer);
+
+	//The budget is the host block, the time it lasts at the host rate
+	loadMeter.endBlock(buffer.getNumSamples());
+}
+
+template<typename SampleType>
+bool SoundWizardAudioProcessor::updateOversampling(size_t order, bool linearPhase, bool force)
+{
+	if (!force && order == activeOversamplingOrder && linearPhase == activeLinearPhase)
+		return false;
+
+	activeOversamplingOrder = order;
+	activeLinearPhase = linearPhase;
+
+	//Every stage was allocated in prepare, switching only clears the state left from the last time it ran
+	auto& chain = getFilterChain<SampleType>();
+	chain.peakHighCut.reset();
+	chain.oversampler.reset();
+
+	updateLatency<SampleType>();
+
+	return true;
+}
+
+template<typename SampleType>
+bool SoundWizardAudioProcessor::updateFilterMode(bool force)
+{
+	//Read before the swap, the designer hands over a new convolver before it marks its kernel done
+	auto kernelReady = kernelVersion.load() >= filterModeVersion.load();
+	auto convolverSwapped = adoptPendingConvolver();
+	auto mode = static_cast<FilterMode>(filterModeParameter->load());
+
+	//The biquads keep running until the FIR has a kernel for the settings it is switched to
+	if (!force && mode == FM_LinearPhaseFIR && activeFilterMode != FM_LinearPhaseFIR && !kernelReady)
+		mode = activeFilterMode;
+
+	if (!force && mode == activeFilterMode)
+	{
+		//A new FIR size only moves the latency while the FIR is the one running
+		if (convolverSwapped && mode == FM_LinearPhaseFIR)
+		{
+			updateLatency<SampleType>();
+			updateTailLength();
+		}
+
+		return false;
+	}
+
+	activeFilterMode = mode;
+
+	//Whichever path takes over starts from silence rather than state left from the last time it ran
+	if (mode == FM_LinearPhaseFIR)
+	{
+		getActiveConvolver().reset();
+	}
+	else
+	{
+		auto& chain = getFilterChain<SampleType>();
+		chain.lowCut.reset();
+		chain.peakHighCut.reset();
+		chain.oversampler.reset();
+
+		//The ramp kept going while the FIR ran, whichever step it reached is applied again
+		activeRampStep = -1;
+	}
+
+	updateLatency<SampleType>();
+	updateTailLength();
+
+	return true;
+}
+
+template<typename SampleType>
+void SoundWizardAudioProcessor::updateLatency()
+{
+	auto latency = getFilterChain<SampleType>().oversampler.getLatencySamples(activeOversamplingOrder, activeLinearPhase);
+
+	if (activeFilterMode == FM_LinearPhaseFIR)
+		latency = getActiveConvolver().getLatencySamples();
+
+	//setLatencySamples calls back into the host, which is not safe from the audio thread
+	if (runningLatencySamples.exchange(latency) != latency)
+		triggerAsyncUpdate();
+}
+
+void SoundWizardAudioProcessor::handleAsyncUpdate()
+{
+	setLatencySamples(runningLatencySamples.load());
+}
+
+int SoundWizardAudioProcessor::getFirKernelOrder() const
+{
+	return 10 + (int)firLengthValue->load();
+}
+
+int SoundWizardAudioProcessor::getFirPartitionOrder() const
+{
+	return 6 + (int)firPartitionValue->load();
+}
+
+bool SoundWizardAudioProcessor::updateLinearPhaseKernel(bool force)
+{
+	auto version = parametersVersion.get();
+	auto kernelOrder = getFirKernelOrder();
+	auto partitionOrder = getFirPartitionOrder();
+
+	auto* convolver = &linearPhaseConvolvers[(size_t)kernelConvolver];
+	auto resize = convolver->getKernelLength() != 1 << kernelOrder || convolver->getPartitionSize() != 1 << partitionOrder;
+
+	if (!force && !resize && version == kernelVersion.load())
+		return true;
+
+	if (resize)
+	{
+		//One the audio thread has not taken yet is taken back and reallocated, otherwise the one it let go of
+		auto notTaken = kernelConvolver;
+
+		if (!pendingConvolver.compare_exchange_strong(notTaken, -1))
+			kernelConvolver = 1 - kernelConvolver;
+
+		convolver = &linearPhaseConvolvers[(size_t)kernelConvolver];
+		convolver->prepare(kernelNumChannels, kernelOrder, partitionOrder);
+	}
+
+	kernelMagnitudes.resize((size_t)convolver->getKernelLength() / 2 + 1);
+
+	FilterCoefficientSet<double> coefficients;
+	makeFilterCoefficients(coefficients, getChainSettings(apvts), kernelSampleRate);
+
+	auto kernelLength = (double)convolver->getKernelLength();
+
+	for (size_t k = 0; k < kernelMagnitudes.size(); ++k)
+		kernelMagnitudes[k] = (float)getMagnitudeForFrequency(coefficients, (double)k * kernelSampleRate / kernelLength, kernelSampleRate);
+
+	auto designed = convolver->setMagnitudeResponse(kernelMagnitudes.data());
+
+	//A new convolver has every slot free, so it always goes over with its first kernel
+	if (resize)
+		pendingConvolver = kernelConvolver;
+
+	//Every slot is busy during a crossfade, the caller tries again
+	if (!designed)
+		return false;
+
+	kernelVersion = version;
+	return true;
+}
+
+bool SoundWizardAudioProcessor::adoptPendingConvolver()
+{
+	auto pending = pendingConvolver.exchange(-1);
+
+	if (pending < 0)
+		return false;
+
+	//Prepared and reset by the designer, it starts from silence with its kernel picked up at the first partition
+	activeConvolver = pending;
+	return true;
+}
+
+void SoundWizardAudioProcessor::requestKernelDesign()
+{
+	//Same as the coefficient designer, only the first request since the designer woke signals it
+	if (!kernelDesignPending.exchange(true))
+		kernelDesignThread.notify();
+}
+
+void SoundWizardAudioProcessor::KernelDesignThread::run()
+{
+	while (!threadShouldExit())
+	{
+		wait(-1);
+
+		processor.kernelDesignPending = false;
+
+		//A crossfade frees a slot within its length, about 20 ms
+		while (!processor.updateLinearPhaseKernel(false) && !threadShouldExit())
+			wait(kernelRetryIntervalMs);
+	}
+}
+
+void SoundWizardAudioProcessor::requestCoefficientDesign()
+{
+	//The listeners can fire on the audio thread, only the first request since the designer woke signals it
+	if (!designPending.exchange(true))
+		coefficientDesignThread.notify();
+}
+
+void SoundWizardAudioProcessor::CoefficientDesignThread::run()
+{
+	while (!threadShouldExit())
+	{
+		wait(-1);
+
+		//Cleared before reading anything, so a change arriving mid design wakes it again
+		processor.designPending = false;
+
+		if (processor.designDoublePrecision)
+			processor.designCoefficientRamp<double>(false);
+		else
+			processor.designCoefficientRamp<float>(false);
+	}
+}
+
+template<typename SampleType>
+void SoundWizardAudioProcessor::designCoefficientRamp(bool force)
+{
+	auto version = parametersVersion.get();
+	auto linksVersion = channelLinksVersion.get();
+
+	if (!force && version == designedParametersVersion && linksVersion == designedLinksVersion)
+		return;
+
+	designedParametersVersion = version;
+	designedLinksVersion = linksVersion;
+
+	//The new ramp sets off from wherever the audio thread has got to on the last one
+	auto position = processedSamples.load();
+
+	rampSettings.skip((int)juce::jmin(position - rampStartSample, (juce::int64)std::numeric_limits<int>::max()));
+	rampSettings.setTargetSettings(getChainSettings(apvts));
+	rampStartSample = position;
+
+	auto& ramp = getRampExchange<SampleType>().getWriteSlot();
+
+	//Once per block has no block to follow here, it runs on the largest one the host sends
+	auto gridSize = getUpdateGridSize(static_cast<UpdateGrid>(updateGridParameter->load()));
+
+	ramp.startSample = position;
+	ramp.gridSize = juce::jmax(gridSize > 0 ? gridSize : designBlockSize, getUpdateGridSize(G_16));
+	ramp.oversamplingOrder = (size_t)static_cast<OversamplingFactor>(oversamplingParameter->load());
+	ramp.linearPhase = static_cast<OversamplingMode>(oversamplingModeParameter->load()) == OM_LinearPhase;
+
+	auto oversampledRate = designSampleRate * (double)(1 << ramp.oversamplingOrder);
+	auto smoothing = rampSettings;
+	ramp.numSteps = 0;
+
+	do
+	{
+		auto& coefficients = ramp.steps[(size_t)ramp.numSteps];
+		makeFilterCoefficients(coefficients, smoothing.skip(ramp.gridSize), designSampleRate, oversampledRate);
+
+		ramp.stepTailSeconds[(size_t)ramp.numSteps] = ::getTailLengthSeconds(coefficients, designSampleRate, oversampledRate);
+		++ramp.numSteps;
+	}
+	while (smoothing.isSmoothing() && ramp.numSteps < (int)ramp.steps.size());
+
+	jassert(!smoothing.isSmoothing());
+
+	//Copied out first, the message thread must not wait on the designs
+	std::array<ChannelLink, maxChannels> links;
+
+	{
+		const juce::SpinLock::ScopedLockType lock(channelLinkLock);
+		links = channelLinks;
+	}
+
+	ramp.allChannelsLinked = true;
+	ramp.unlinkedTailSeconds = 0.0;
+
+	for (size_t channel = 0; channel < designNumChannels; ++channel)
+	{
+		ramp.linked[channel] = links[channel].linked;
+
+		if (links[channel].linked)
+			continue;
+
+		ramp.allChannelsLinked = false;
+		makeFilterCoefficients(ramp.unlinked[channel], links[channel].settings, designSampleRate, oversampledRate);
+
+		ramp.unlinkedTailSeconds = juce::jmax(ramp.unlinkedTailSeconds,
+			::getTailLengthSeconds(ramp.unlinked[channel], designSampleRate, oversampledRate));
+	}
+
+	getRampExchange<SampleType>().publish();
+}
+
+template<typename SampleType>
+void SoundWizardAudioProcessor::pullCoefficientRamp(bool force)
+{
+	auto* ramp = getRampExchange<SampleType>().acquire();
+
+	if (ramp == nullptr)
+		return;
+
+	//The steps were designed for this rate, so the chain switches to it along with them
+	updateOversampling<SampleType>(ramp->oversamplingOrder, ramp->linearPhase, force);
+
+	auto& filterChain = getFilterChain<SampleType>();
+
+	for (size_t channel = 0; channel < filterChain.getNumChannels(); ++channel)
+		if (!ramp->linked[channel])
+			::applyCoefficients(filterChain, ramp->unlinked[channel], channel);
 
-	//We need to extract left and right chanel from buffer
+	unlinkedTailSeconds = ramp->unlinkedTailSeconds;
 
-	juce::dsp::AudioBlock<float> block(buffer);
+	//The linked channels take whichever step the ramp is at on the next block
+	activeRampStep = -1;
+}
 
-	auto leftBlock = block.getSingleChannelBlock(0);
-	auto rightBlock = block.getSingleChannelBlock(1);
+template<typename SampleType>
+void SoundWizardAudioProcessor::applyRampStep(const CoefficientRamp<SampleType>& ramp, int index)
+{
+	auto& filterChain = getFilterChain<SampleType>();
+	const auto& coefficients = ramp.steps[(size_t)index];
 
-	juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-	juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+	if (ramp.allChannelsLinked)
+	{
+		::applyCoefficients(filterChain, coefficients);
+	}
+	else
+	{
+		for (size_t channel = 0; channel < filterChain.getNumChannels(); ++channel)
+			if (ramp.linked[channel])
+				::applyCoefficients(filterChain, coefficients, channel);
+	}
+
+	activeRampStep = index;
+	linkedTailSeconds = ramp.stepTailSeconds[(size_t)index];
+	updateTailLength();
+}
+
+template<typename SampleType>
+void SoundWizardAudioProcessor::designRampNow()
+{
+	designCoefficientRamp<SampleType>(true);
+}
 
-	leftChain.process(leftContext);
-	rightChain.process(rightContext);
+template<typename SampleType>
+int SoundWizardAudioProcessor::pullRampNow()
+{
+	pullCoefficientRamp<SampleType>(false);
+	return getRampExchange<SampleType>().getReadSlot().numSteps;
+}
 
-	leftChanelQueue.update(buffer);
-	rightChanelQueue.update(buffer);
+template<typename SampleType>
+void SoundWizardAudioProcessor::applyRampStepNow(int index)
+{
+	applyRampStep(getRampExchange<SampleType>().getReadSlot(), index);
 }
 
 //==============================================================================
@@ -200,7 +679,10 @@ void SoundWizardAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
 	// You could do that either as raw data, or use the XML or ValueTree classes
 	// as intermediaries to make it easy to save and load complex data.
 	juce::MemoryOutputStream mos(destData, true);
-	apvts.state.writeToStream(mos);
+
+	auto state = apvts.copyState();
+	state.appendChild(createChannelLinksTree(), nullptr);
+	state.writeToStream(mos);
 }
 
 void SoundWizardAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
@@ -208,8 +690,13 @@ void SoundWizardAudioProcessor::setStateInformation(const void* data, int sizeIn
 	auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
 	if (tree.isValid())
 	{
+		auto links = tree.getChildWithName("ChannelLinks");
+		restoreChannelLinks(links);
+		tree.removeChild(links, nullptr);
+
 		apvts.replaceState(tree);
-		updateFilters();
+		parametersVersion += 1;
+		requestCoefficientDesign();
 	}
 	// You should use this method to restore your parameters from this memory block,
 	// whose contents will have been created by the getStateInformation() call.
@@ -267,7 +754,7 @@ juce::AudioProcessorValueTreeState::ParameterLayout SoundWizardAudioProcessor::c
 
 	//Choises for Slopes
 	juce::StringArray stringArray;
-	for (auto i = 0; i < 4; i++)
+	for (auto i = 0; i < 8; i++)
 	{
 		juce::String str;
 		str << (12 + i * 12);
@@ -278,102 +765,473 @@ juce::AudioProcessorValueTreeState::ParameterLayout SoundWizardAudioProcessor::c
 	layout.add(std::make_unique<juce::AudioParameterChoice>("LowCut Slope", "LowCut Slope", stringArray, 0));
 	layout.add(std::make_unique<juce::AudioParameterChoice>("HighCut Slope", "HighCut Slope", stringArray, 0));
 
+	//Choises for how often ramping parameters redesign the filters, finer grids cost more CPU
+	juce::StringArray gridChoices{ "16 Samples", "32 Samples", "64 Samples", "Per Block" };
+
+	layout.add(std::make_unique<juce::AudioParameterChoice>("Update Grid", "Update Grid", gridChoices, UpdateGrid::G_32));
+
+	//Peak and high cut oversampling, the reported latency follows the choise
+	juce::StringArray oversamplingChoices{ "Off", "2x", "4x", "8x" };
+	juce::StringArray oversamplingModeChoices{ "Minimum Phase", "Linear Phase" };
+
+	layout.add(std::make_unique<juce::AudioParameterChoice>("Oversampling", "Oversampling", oversamplingChoices, OversamplingFactor::OS_Off));
+	layout.add(std::make_unique<juce::AudioParameterChoice>("Oversampling Mode", "Oversampling Mode", oversamplingModeChoices, OversamplingMode::OM_MinimumPhase));
+
+	//Linear phase FIR, longer kernels resolve the low cut better and partitions trade latency for CPU
+	juce::StringArray filterModeChoices{ "IIR", "Linear Phase FIR" };
+	juce::StringArray firLengthChoices{ "1024", "2048", "4096", "8192", "16384" };
+	juce::StringArray firPartitionChoices{ "64", "128", "256", "512", "1024" };
+
+	layout.add(std::make_unique<juce::AudioParameterChoice>("Filter Mode", "Filter Mode", filterModeChoices, FilterMode::FM_IIR));
+
+	//Either one reallocates a convolver on the FIR designer and moves the latency, too much to automate
+	auto prepareOnly = juce::AudioParameterChoiceAttributes().withAutomatable(false);
+
+	layout.add(std::make_unique<juce::AudioParameterChoice>("FIR Length", "FIR Length", firLengthChoices, 2, prepareOnly));
+	layout.add(std::make_unique<juce::AudioParameterChoice>("FIR Partition", "FIR Partition", firPartitionChoices, 2, prepareOnly));
+
+	//How much consecutive analyzer windows share, more overlap means more FFTs and a smoother display
+	juce::StringArray analyzerOverlapChoices{ "50%", "75%", "87.5%" };
+
+	layout.add(std::make_unique<juce::AudioParameterChoice>("Analyzer Overlap", "Analyzer Overlap", analyzerOverlapChoices, 1));
+
+	//Time constant of the analyzer's average over FFT frames
+	juce::StringArray analyzerAveragingChoices{ "Off", "Fast", "Medium", "Slow" };
+
+	layout.add(std::make_unique<juce::AudioParameterChoice>("Analyzer Averaging", "Analyzer Averaging", analyzerAveragingChoices, 2));
+
+	//FFT size of the analyzer, only the editor reads it
+	juce::StringArray analyzerResolutionChoices{ "2048", "4096", "8192" };
+
+	layout.add(std::make_unique<juce::AudioParameterChoice>("Analyzer Resolution", "Analyzer Resolution", analyzerResolutionChoices, 0));
+
 	return layout;
 }
 
 
 
-inline void updateCoefficients(Coefficients& old, const Coefficients& replacements)
+template<typename SampleType>
+void makePeakFilter(BiquadCoefficients<SampleType>& peak, const ChainSettings& chainSettings, double sampleRate)
 {
-	*old = *replacements;
+	FilterDesign::designPeak(peak,
+		chainSettings.peakFreq,
+		chainSettings.peakQuality,
+		juce::Decibels::decibelsToGain(chainSettings.peakGainDecibels),
+		sampleRate);
 }
 
-Coefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate)
+template<typename SampleType>
+void makeLowCutFilter(CutCoefficients<SampleType>& lowCut, const ChainSettings& chainSettings, double sampleRate)
 {
-	return juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-		sampleRate,
-		chainSettings.peakFreq,
-		chainSettings.peakQuality,
-		juce::Decibels::decibelsToGain(chainSettings.peakGainDecibels));
+	FilterDesign::designButterworthHighPass(lowCut,
+		(chainSettings.lowCutSlope + 1) * 2,
+		chainSettings.lowCutFreq,
+		sampleRate);
+}
+
+template<typename SampleType>
+void makeHighCutFilter(CutCoefficients<SampleType>& highCut, const ChainSettings& chainSettings, double sampleRate)
+{
+	FilterDesign::designButterworthLowPass(highCut,
+		(chainSettings.highCutSlope + 1) * 2,
+		chainSettings.highCutFreq,
+		sampleRate);
 }
 
+template<typename SampleType>
+void makeFilterCoefficients(FilterCoefficientSet<SampleType>& set, const ChainSettings& chainSettings, double sampleRate)
+{
+	makeFilterCoefficients(set, chainSettings, sampleRate, sampleRate);
+}
 
-void SoundWizardAudioProcessor::updatePeakFilter(const ChainSettings& chainSettings)
+template<typename SampleType>
+void makeFilterCoefficients(FilterCoefficientSet<SampleType>& set, const ChainSettings& chainSettings,
+	double sampleRate, double oversampledRate)
 {
-	auto peekCoefficient = makePeakFilter(chainSettings, getSampleRate());
+	makePeakFilter(set.peak, chainSettings, oversampledRate);
+	makeLowCutFilter(set.lowCut, chainSettings, sampleRate);
+	makeHighCutFilter(set.highCut, chainSettings, oversampledRate);
 
-	updateCoefficients(leftChain.get<ChainPossition::Peak>().coefficients, peekCoefficient);
-	updateCoefficients(rightChain.get<ChainPossition::Peak>().coefficients, peekCoefficient);
+	set.lowCutSlope = chainSettings.lowCutSlope;
+	set.highCutSlope = chainSettings.highCutSlope;
 }
 
-void SoundWizardAudioProcessor::updateLowCutFilters(const ChainSettings& chainSettings)
+template<typename SampleType>
+double getTailLengthSeconds(const FilterCoefficientSet<SampleType>& coefficients, double sampleRate, double oversampledRate)
 {
-	auto lowCutCoefficients = makeLowCutFilter(chainSettings, getSampleRate());
+	auto lowCutRadius = 0.0;
 
-	auto& leftLowCut = leftChain.get<ChainPossition::LowCut>();
-	auto& rightLowCut = rightChain.get<ChainPossition::LowCut>();
-	updateCutFilter(leftLowCut, lowCutCoefficients, chainSettings.lowCutSlope);
-	updateCutFilter(rightLowCut, lowCutCoefficients, chainSettings.lowCutSlope);
+	for (int i = 0; i <= coefficients.lowCutSlope; ++i)
+		lowCutRadius = juce::jmax(lowCutRadius, FilterDesign::getPoleRadius(coefficients.lowCut[(size_t)i]));
+
+	//The peak and high cut poles are per sample of the rate they run at
+	auto oversampledRadius = FilterDesign::getPoleRadius(coefficients.peak);
+
+	for (int i = 0; i <= coefficients.highCutSlope; ++i)
+		oversampledRadius = juce::jmax(oversampledRadius, FilterDesign::getPoleRadius(coefficients.highCut[(size_t)i]));
+
+	return juce::jmax(FilterDesign::getDecaySamples(lowCutRadius) / sampleRate,
+		FilterDesign::getDecaySamples(oversampledRadius) / oversampledRate);
 }
 
-void SoundWizardAudioProcessor::updateHighCutFilters(const ChainSettings& chainSettings)
+template<typename SampleType>
+double getMagnitudeForFrequency(const FilterCoefficientSet<SampleType>& coefficients, double frequency, double sampleRate)
 {
-	auto highCutCoefficients = makeHighCutFilter(chainSettings,getSampleRate());
+	auto magnitude = FilterDesign::getMagnitudeForFrequency(coefficients.peak, frequency, sampleRate);
+
+	for (int i = 0; i <= coefficients.lowCutSlope; ++i)
+		magnitude *= FilterDesign::getMagnitudeForFrequency(coefficients.lowCut[(size_t)i], frequency, sampleRate);
+
+	for (int i = 0; i <= coefficients.highCutSlope; ++i)
+		magnitude *= FilterDesign::getMagnitudeForFrequency(coefficients.highCut[(size_t)i], frequency, sampleRate);
 
-	auto& leftHighCut = leftChain.get<ChainPossition::HighCut>();
-	auto& rightHighCut = rightChain.get<ChainPossition::HighCut>();
-	updateCutFilter(leftHighCut, highCutCoefficients, chainSettings.highCutSlope);
-	updateCutFilter(rightHighCut, highCutCoefficients, chainSettings.highCutSlope);
+	return magnitude;
 }
 
-void SoundWizardAudioProcessor::updateFilters()
+template<typename SampleType>
+void applyCoefficients(ChannelChain<SampleType>& chain, const FilterCoefficientSet<SampleType>& coefficients)
 {
-	auto chainSettings = getChainSettings(apvts);
+	for (size_t channel = 0; channel < chain.getNumChannels(); ++channel)
+		applyCoefficients(chain, coefficients, channel);
+}
+
+template<typename SampleType>
+void applyCoefficients(ChannelChain<SampleType>& chain, const FilterCoefficientSet<SampleType>& coefficients, size_t channel)
+{
+	//Sections past the slope are bypassed, the way a ProcessorChain skips its stages
+	for (size_t i = 0; i < maxCutSections; ++i)
+	{
+		chain.lowCut.setSection(channel, i, coefficients.lowCut[i]);
+		chain.lowCut.setSectionBypassed(channel, i, (int)i > coefficients.lowCutSlope);
+	}
+
+	chain.peakHighCut.setSection(channel, 0, coefficients.peak);
+
+	for (size_t i = 0; i < maxCutSections; ++i)
+	{
+		chain.peakHighCut.setSection(channel, 1 + i, coefficients.highCut[i]);
+		chain.peakHighCut.setSectionBypassed(channel, 1 + i, (int)i > coefficients.highCutSlope);
+	}
+}
+
+template<typename SampleType>
+void ChannelChain<SampleType>::prepare(const juce::dsp::ProcessSpec& spec)
+{
+	lowCut.prepare(spec);
+	oversampler.prepare(spec);
 
-	updatePeakFilter(chainSettings);
+	//Sized for the largest factor, so switching never resizes anything
+	auto oversampledSpec = spec;
+	oversampledSpec.sampleRate *= (double)(1 << ChainOversampler<SampleType>::maxOrder);
+	oversampledSpec.maximumBlockSize <<= ChainOversampler<SampleType>::maxOrder;
 
-	updateLowCutFilters(chainSettings);
-	updateHighCutFilters(chainSettings);
+	peakHighCut.prepare(oversampledSpec);
 }
 
-template<typename ChainType, typename CoefficientType>
-void updateCutFilter(ChainType& chain,
-		const CoefficientType& coefficients,
-		const Slope& slope)
+int getUpdateGridSize(UpdateGrid grid)
 {
-	chain.setBypassed<0>(true);
-	chain.setBypassed<1>(true);
-	chain.setBypassed<2>(true);
-	chain.setBypassed<3>(true);
+	switch (grid)
+	{
+		case G_16: return 16;
+		case G_32: return 32;
+		case G_64: return 64;
+		case G_PerBlock: break;
+	}
 
-	switch( slope )
-    {
-        case S_48:
-        {
-            updateSlope<3>(chain, coefficients);
-        }
-        case S_36:
-        {
-            updateSlope<2>(chain, coefficients);
-        }
-        case S_24:
-        {
-            updateSlope<1>(chain, coefficients);
-        }
-        case S_12:
-        {
-            updateSlope<0>(chain, coefficients);
-        }
-    }
+	return 0;
 }
 
-template<int Index, typename ChainType, typename CoefficientType>
-inline void updateSlope(ChainType & chainType, const CoefficientType & coefficients)
+void SmoothedChainSettings::reset(double sampleRate, double rampLengthSeconds)
 {
-	updateCoefficients(chainType.template get<Index>().coefficients, coefficients[Index]);
-    chainType.template setBypassed<Index>(false);
+	peakFreq.reset(sampleRate, rampLengthSeconds);
+	peakQuality.reset(sampleRate, rampLengthSeconds);
+	peakGainDecibels.reset(sampleRate, rampLengthSeconds);
+	lowCutFreq.reset(sampleRate, rampLengthSeconds);
+	highCutFreq.reset(sampleRate, rampLengthSeconds);
 }
 
+void SmoothedChainSettings::setCurrentAndTargetSettings(const ChainSettings& chainSettings)
+{
+	peakFreq.setCurrentAndTargetValue(chainSettings.peakFreq);
+	peakQuality.setCurrentAndTargetValue(chainSettings.peakQuality);
+	peakGainDecibels.setCurrentAndTargetValue(chainSettings.peakGainDecibels);
+	lowCutFreq.setCurrentAndTargetValue(chainSettings.lowCutFreq);
+	highCutFreq.setCurrentAndTargetValue(chainSettings.highCutFreq);
+
+	lowCutSlope = chainSettings.lowCutSlope;
+	highCutSlope = chainSettings.highCutSlope;
+}
+
+void SmoothedChainSettings::setTargetSettings(const ChainSettings& chainSettings)
+{
+	peakFreq.setTargetValue(chainSettings.peakFreq);
+	peakQuality.setTargetValue(chainSettings.peakQuality);
+	peakGainDecibels.setTargetValue(chainSettings.peakGainDecibels);
+	lowCutFreq.setTargetValue(chainSettings.lowCutFreq);
+	highCutFreq.setTargetValue(chainSettings.highCutFreq);
+
+	lowCutSlope = chainSettings.lowCutSlope;
+	highCutSlope = chainSettings.highCutSlope;
+}
+
+bool SmoothedChainSettings::isSmoothing() const
+{
+	return peakFreq.isSmoothing() || peakQuality.isSmoothing() || peakGainDecibels.isSmoothing()
+		|| lowCutFreq.isSmoothing() || highCutFreq.isSmoothing();
+}
+
+ChainSettings SmoothedChainSettings::skip(int numSamples)
+{
+	peakFreq.skip(numSamples);
+	peakQuality.skip(numSamples);
+	peakGainDecibels.skip(numSamples);
+	lowCutFreq.skip(numSamples);
+	highCutFreq.skip(numSamples);
+
+	return getCurrentSettings();
+}
+
+ChainSettings SmoothedChainSettings::getCurrentSettings() const
+{
+	ChainSettings settings;
+
+	settings.peakFreq = peakFreq.getCurrentValue();
+	settings.peakQuality = peakQuality.getCurrentValue();
+	settings.peakGainDecibels = peakGainDecibels.getCurrentValue();
+	settings.lowCutFreq = lowCutFreq.getCurrentValue();
+	settings.highCutFreq = highCutFreq.getCurrentValue();
+
+	settings.lowCutSlope = lowCutSlope;
+	settings.highCutSlope = highCutSlope;
+
+	return settings;
+}
+
+//==============================================================================
+void SoundWizardAudioProcessor::parameterValueChanged(int parameterIndex, float newValue)
+{
+	//The FIR size means nothing to the biquads
+	if (parameterIndex != firLengthParameter->getParameterIndex() && parameterIndex != firPartitionParameter->getParameterIndex())
+	{
+		parametersVersion += 1;
+		requestCoefficientDesign();
+	}
+
+	auto mode = static_cast<FilterMode>(filterModeParameter->load());
+
+	//The raw value may not have moved yet while the listeners run, the switch itself comes from the new value
+	if (parameterIndex == filterModeChoiceParameter->getParameterIndex())
+	{
+		mode = static_cast<FilterMode>(juce::roundToInt(filterModeChoiceParameter->convertFrom0to1(newValue)));
+
+		if (mode == FM_LinearPhaseFIR)
+			filterModeVersion = parametersVersion.get();
+	}
+
+	//The kernel is only needed while the FIR runs, switching to it designs one for the settings at that point
+	if (mode == FM_LinearPhaseFIR)
+		requestKernelDesign();
+}
+
+template<typename SampleType>
+void SoundWizardAudioProcessor::processFilters(juce::dsp::AudioBlock<SampleType>& block)
+{
+	auto& chain = getFilterChain<SampleType>();
+	juce::dsp::ProcessContextReplacing<SampleType> context(block);
+
+	chain.lowCut.process(context);
+
+	if (activeOversamplingOrder == 0)
+	{
+		chain.peakHighCut.process(context);
+		return;
+	}
+
+	auto& stage = chain.oversampler.getStage(activeOversamplingOrder, activeLinearPhase);
+
+	//With the cascade rung out, silence from the low cut needs no trip through the oversampler either
+	auto inputIsSilent = chain.peakHighCut.isIdle() && isSilent(block);
+
+	if (inputIsSilent && chain.oversamplerFlushed)
+		return;
+
+	auto oversampledBlock = stage.processSamplesUp(block);
+
+	chain.peakHighCut.process(juce::dsp::ProcessContextReplacing<SampleType>(oversampledBlock));
+	stage.processSamplesDown(block);
+
+	if (!inputIsSilent)
+	{
+		chain.oversamplerSilentSamples = 0;
+		chain.oversamplerFlushed = false;
+		return;
+	}
+
+	//The tail of the last signal is still coming out of the downsampler until a latency worth of silence
+	//went in after it, only then is what is left inside silent as well and safe to drop
+	auto latency = chain.oversampler.getLatencySamples(activeOversamplingOrder, activeLinearPhase);
+
+	chain.oversamplerSilentSamples = juce::jmin(chain.oversamplerSilentSamples + (int)block.getNumSamples(), latency);
+
+	if (chain.oversamplerSilentSamples >= latency && isSilent(block))
+	{
+		stage.reset();
+		chain.oversamplerFlushed = true;
+	}
+}
+
+//==============================================================================
+void SoundWizardAudioProcessor::setChannelLinked(int channel, bool shouldBeLinked)
+{
+	jassert(juce::isPositiveAndBelow(channel, maxChannels));
+
+	{
+		const juce::SpinLock::ScopedLockType lock(channelLinkLock);
+		channelLinks[(size_t)channel].linked = shouldBeLinked;
+	}
+
+	channelLinksVersion += 1;
+	requestCoefficientDesign();
+}
+
+bool SoundWizardAudioProcessor::isChannelLinked(int channel) const
+{
+	jassert(juce::isPositiveAndBelow(channel, maxChannels));
+
+	const juce::SpinLock::ScopedLockType lock(channelLinkLock);
+	return channelLinks[(size_t)channel].linked;
+}
+
+void SoundWizardAudioProcessor::setUnlinkedChannelSettings(int channel, const ChainSettings& settings)
+{
+	jassert(juce::isPositiveAndBelow(channel, maxChannels));
+
+	{
+		const juce::SpinLock::ScopedLockType lock(channelLinkLock);
+		channelLinks[(size_t)channel].settings = settings;
+	}
+
+	channelLinksVersion += 1;
+	requestCoefficientDesign();
+}
+
+ChainSettings SoundWizardAudioProcessor::getUnlinkedChannelSettings(int channel) const
+{
+	jassert(juce::isPositiveAndBelow(channel, maxChannels));
+
+	const juce::SpinLock::ScopedLockType lock(channelLinkLock);
+	return channelLinks[(size_t)channel].settings;
+}
+
+static juce::ValueTree createChainSettingsTree(const juce::Identifier& type, const ChainSettings& settings)
+{
+	juce::ValueTree tree(type);
+
+	tree.setProperty("LowCut Freq", settings.lowCutFreq, nullptr);
+	tree.setProperty("HighCut Freq", settings.highCutFreq, nullptr);
+	tree.setProperty("Peak Freq", settings.peakFreq, nullptr);
+	tree.setProperty("Peak Gain", settings.peakGainDecibels, nullptr);
+	tree.setProperty("Peak Quality", settings.peakQuality, nullptr);
+	tree.setProperty("LowCut Slope", (int)settings.lowCutSlope, nullptr);
+	tree.setProperty("HighCut Slope", (int)settings.highCutSlope, nullptr);
+
+	return tree;
+}
+
+static ChainSettings readChainSettingsTree(const juce::ValueTree& tree)
+{
+	ChainSettings settings;
+
+	settings.lowCutFreq = tree.getProperty("LowCut Freq", 20.f);
+	settings.highCutFreq = tree.getProperty("HighCut Freq", 20000.f);
+	settings.peakFreq = tree.getProperty("Peak Freq", 750.f);
+	settings.peakGainDecibels = tree.getProperty("Peak Gain", 0.f);
+	settings.peakQuality = tree.getProperty("Peak Quality", 1.f);
+	settings.lowCutSlope = static_cast<Slope>((int)tree.getProperty("LowCut Slope", 0));
+	settings.highCutSlope = static_cast<Slope>((int)tree.getProperty("HighCut Slope", 0));
+
+	return settings;
+}
+
+juce::ValueTree SoundWizardAudioProcessor::createChannelLinksTree() const
+{
+	juce::ValueTree links("ChannelLinks");
+
+	const juce::SpinLock::ScopedLockType lock(channelLinkLock);
+
+	//Only unlinked channels are worth storing
+	for (int channel = 0; channel < maxChannels; ++channel)
+	{
+		const auto& link = channelLinks[(size_t)channel];
+
+		if (link.linked)
+			continue;
+
+		auto child = createChainSettingsTree("UnlinkedChannel", link.settings);
+		child.setProperty("Channel", channel, nullptr);
+		links.appendChild(child, nullptr);
+	}
+
+	return links;
+}
+
+void SoundWizardAudioProcessor::restoreChannelLinks(const juce::ValueTree& links)
+{
+	{
+		const juce::SpinLock::ScopedLockType lock(channelLinkLock);
+
+		for (auto& link : channelLinks)
+			link.linked = true;
+
+		for (const auto& child : links)
+		{
+			int channel = child.getProperty("Channel", -1);
+
+			if (!juce::isPositiveAndBelow(channel, maxChannels))
+				continue;
+
+			channelLinks[(size_t)channel].linked = false;
+			channelLinks[(size_t)channel].settings = readChainSettingsTree(child);
+		}
+	}
+
+	channelLinksVersion += 1;
+	requestCoefficientDesign();
+}
+
+void SoundWizardAudioProcessor::updateTailLength()
+{
+	auto sampleRate = getSampleRate();
+
+	if (sampleRate <= 0.0)
+		return;
+
+	//Input that stops still has the latency to come out, then the ringing of the slowest pole or the FIR
+	if (activeFilterMode == FM_LinearPhaseFIR)
+		tailLengthSeconds = (double)(runningLatencySamples.load() + getActiveConvolver().getKernelLength() / 2) / sampleRate;
+	else
+		tailLengthSeconds = (double)runningLatencySamples.load() / sampleRate + juce::jmax(linkedTailSeconds, unlinkedTailSeconds);
+}
+
+//The editor draws its response from double precision coefficients
+template void makeFilterCoefficients(FilterCoefficientSet<double>&, const ChainSettings&, double);
+
+//The tests run the cascade of both precisions outside the processor
+template void makeFilterCoefficients(FilterCoefficientSet<float>&, const ChainSettings&, double, double);
+template void makeFilterCoefficients(FilterCoefficientSet<double>&, const ChainSettings&, double, double);
+template struct ChannelChain<float>;
+template struct ChannelChain<double>;
+template void applyCoefficients(ChannelChain<float>&, const FilterCoefficientSet<float>&);
+template void applyCoefficients(ChannelChain<double>&, const FilterCoefficientSet<double>&);
+
+//The benchmarks time both halves of a ramp in both precisions
+template void SoundWizardAudioProcessor::designRampNow<float>();
+template void SoundWizardAudioProcessor::designRampNow<double>();
+template int SoundWizardAudioProcessor::pullRampNow<float>();
+template int SoundWizardAudioProcessor::pullRampNow<double>();
+template void SoundWizardAudioProcessor::applyRampStepNow<float>(int);
+template void SoundWizardAudioProcessor::applyRampStepNow<double>(int);
+
 
 
 //==============================================================================
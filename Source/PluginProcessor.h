@@ -9,56 +9,62 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "FilterDesign.h"
+#include "BiquadCascade.h"
+#include "ChainOversampler.h"
+#include "LinearPhaseConvolver.h"
+#include "LoadMeter.h"
 
 // 
-template<typename T>
+//Counters a Queue keeps about itself, any thread may read them
+struct QueueStats
+{
+    int dropped = 0;     //pushes refused because the queue was full
+    int highWater = 0;   //most items ever waiting at once
+    int consumerLag = 0; //items already waiting when the consumer last pulled
+};
+
+//Wait-free single producer, single consumer queue.
+//Slots are filled once in prepare and then exchanged with the caller's object, so neither side allocates.
+template<typename T, int Capacity = 30>
 struct Queue
 {
-    /*ϳ */
-    void prepare(int numChannels, int numSamples)
-    {
-        static_assert( std::is_same_v<T, juce::AudioBuffer<float>>,
-                      "prepare(numChannels, numSamples) should only be used when the Queue is holding juce::AudioBuffer<float>");
-        for( auto& buffer : buffers)
-        {
-            buffer.setSize(numChannels,
-                           numSamples,
-                           false,   // ?
-                           true,    //  ?
-                           true);   // ?
-            buffer.clear();
-        }
-    }
-    
-    void prepare(size_t numElements)
+    static_assert( Capacity > 1, "AbstractFifo keeps one slot free, so Capacity - 1 items fit" );
+
+    //Every slot starts as a copy of the prototype, sized the way the producer will fill it
+    void prepare(const T& prototype)
     {
-        static_assert( std::is_same_v<T, std::vector<float>>,
-                      "prepare(numElements) should only be used when the Queue is holding std::vector<float>");
         for( auto& buffer : buffers )
-        {
-            buffer.clear();
-            buffer.resize(numElements, 0);
-        }
+            buffer = prototype;
+
+        queue.reset();
     }
     
-    bool push(const T& t)
+    //Swaps t into the queue, t comes back holding a free slot's storage to fill next time
+    bool push(T& t)
     {
         auto write = queue.write(1);
         if( write.blockSize1 > 0 )
         {
-            buffers[write.startIndex1] = t;
+            std::swap(buffers[write.startIndex1], t);
+            highWater.store(juce::jmax(highWater.load(std::memory_order_relaxed), queue.getNumReady() + 1),
+                            std::memory_order_relaxed);
             return true;
         }
         
+        dropped.fetch_add(1, std::memory_order_relaxed);
         return false;
     }
     
+    //Swaps the oldest item into t, t's old storage goes back to the producer
     bool pull(T& t)
     {
+        consumerLag.store(queue.getNumReady(), std::memory_order_relaxed);
+
         auto read = queue.read(1);
         if( read.blockSize1 > 0 )
         {
-            t = buffers[read.startIndex1];
+            std::swap(t, buffers[read.startIndex1]);
             return true;
         }
         
@@ -69,80 +75,151 @@ struct Queue
     {
         return queue.getNumReady();
     }
+
+    QueueStats getStats() const
+    {
+        return { dropped.load(std::memory_order_relaxed),
+                 highWater.load(std::memory_order_relaxed),
+                 consumerLag.load(std::memory_order_relaxed) };
+    }
 private:
-    static constexpr int Capacity = 30;
     std::array<T, Capacity> buffers;
     juce::AbstractFifo queue {Capacity};
+
+    std::atomic<int> dropped { 0 }, highWater { 0 }, consumerLag { 0 };
 };
 
 enum Channel
 {
-	Right, //0
-	Left //1
+	Left, //0
+	Right //1
 };
 
 // 
-template<typename BlockType>
+//Wait-free single producer, single consumer ring of raw samples for the analyzer tap.
+//The audio thread writes whole blocks with at most two copies, the reader pulls windows of any length.
+//The ring is allocated once and never moves, since the reader keeps running while the host prepares again.
 struct SingleChannelSampleQueue
 {
-    SingleChannelSampleQueue(Channel ch) : channelToUse(ch)
+    //Room for a few blocks beyond the largest analyzer window, a host block larger than the ring is dropped
+    static constexpr int capacity = 1 << 16;
+
+    SingleChannelSampleQueue(Channel ch) : channelToUse(ch), ring((size_t)capacity, 0.f)
     {
         prepared.set(false);
     }
     
-    void update(const BlockType& buffer)
+    template<typename SampleType>
+    void update(const juce::AudioBuffer<SampleType>& buffer)
     {
         jassert(prepared.get());
-        jassert(buffer.getNumChannels() > channelToUse );
-        auto* channelPtr = buffer.getReadPointer(channelToUse);
-        
-        for( int i = 0; i < buffer.getNumSamples(); ++i )
+        jassert(buffer.getNumChannels() > 0);
+
+        //Layouts narrower than stereo fall back to the last channel there is
+        auto* channelPtr = buffer.getReadPointer(juce::jmin((int)channelToUse, buffer.getNumChannels() - 1));
+        auto numSamples = buffer.getNumSamples();
+
+        auto write = writePosition.load(std::memory_order_relaxed);
+        auto read = readPosition.load(std::memory_order_acquire);
+
+        //A reader that fell behind misses the newest block, the writer never waits for it
+        if( numSamples > capacity - (int)(write - read) )
         {
-            pushNextSampleIntoQueue(channelPtr[i]);
+            droppedBlocks.fetch_add(1, std::memory_order_relaxed);
+            return;
         }
+
+        auto start = (int)(write & (juce::uint64)(capacity - 1));
+        auto size1 = juce::jmin(numSamples, capacity - start);
+
+        copySamples(ring.data() + start, channelPtr, size1);
+        copySamples(ring.data(), channelPtr + size1, numSamples - size1);
+
+        writePosition.store(write + (juce::uint64)numSamples, std::memory_order_release);
     }
 
+    //Called while the audio thread is stopped. Only the reader moves the read position,
+    //so it drops what was written before this itself, the next time it looks.
     void prepare(int bufferSize)
     {
-        prepared.set(false);
         size.set(bufferSize);
-        
-        bufferToFill.setSize(1,             //
-                             bufferSize,    // 
-                             false,         //  
-                             true,          //  '
-                             true);         // 
-        audioBufferQueue.prepare(1, bufferSize);
-        queueIndex = 0;
+
+        resetPosition.store(writePosition.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        resetRequested.store(true, std::memory_order_release);
+
         prepared.set(true);
     }
     //==============================================================================
-    int getNumCompleteBuffersAvailable() const { return audioBufferQueue.getNumAvailableForReading(); }
+    //Reader side, like pull and skip
+    int getNumReady()
+    {
+        applyPendingReset();
+        return (int)(writePosition.load(std::memory_order_acquire) - readPosition.load(std::memory_order_relaxed));
+    }
     bool isPrepared() const { return prepared.get(); }
     int getSize() const { return size.get(); }
+    //Blocks update turned away because the reader was behind, a running total
+    juce::uint32 getNumDroppedBlocks() const { return droppedBlocks.load(std::memory_order_relaxed); }
     //==============================================================================
-    bool getAudioBuffer(BlockType& buf) { return audioBufferQueue.pull(buf); }
+    //Copies the oldest numSamples into destination, at most two copies
+    bool pull(float* destination, int numSamples)
+    {
+        if( numSamples > getNumReady() )
+            return false;
+
+        auto read = readPosition.load(std::memory_order_relaxed);
+
+        auto start = (int)(read & (juce::uint64)(capacity - 1));
+        auto size1 = juce::jmin(numSamples, capacity - start);
+
+        juce::FloatVectorOperations::copy(destination, ring.data() + start, size1);
+        juce::FloatVectorOperations::copy(destination + size1, ring.data(), numSamples - size1);
+
+        readPosition.store(read + (juce::uint64)numSamples, std::memory_order_release);
+        return true;
+    }
+
+    //Drops the oldest numSamples, for a reader that only wants the newest window
+    void skip(int numSamples)
+    {
+        numSamples = juce::jmin(numSamples, getNumReady());
+        readPosition.store(readPosition.load(std::memory_order_relaxed) + (juce::uint64)numSamples, std::memory_order_release);
+    }
 private:
     Channel channelToUse;
-    int queueIndex = 0;
-    Queue<BlockType> audioBufferQueue;
-    BlockType bufferToFill;
+    std::vector<float> ring;
+    //Running totals, so full and empty never look the same
+    std::atomic<juce::uint64> writePosition { 0 }, readPosition { 0 };
+    std::atomic<juce::uint32> droppedBlocks { 0 };
+
+    //Where the write position stood when prepare asked the reader to start over
+    std::atomic<juce::uint64> resetPosition { 0 };
+    std::atomic<bool> resetRequested { false };
+
+    void applyPendingReset()
+    {
+        if( !resetRequested.exchange(false, std::memory_order_acquire) )
+            return;
+
+        //Never backwards, in case the reader already went past it
+        auto read = readPosition.load(std::memory_order_relaxed);
+        readPosition.store(juce::jmax(read, resetPosition.load(std::memory_order_relaxed)), std::memory_order_release);
+    }
     juce::Atomic<bool> prepared = false;
     juce::Atomic<int> size = 0;
-    
-    void pushNextSampleIntoQueue(float sample)
+
+    template<typename SampleType>
+    static void copySamples(float* destination, const SampleType* source, int numSamples)
     {
-        if (queueIndex == bufferToFill.getNumSamples())
+        if constexpr( std::is_same_v<SampleType, float> )
         {
-            auto ok = audioBufferQueue.push(bufferToFill);
-
-            juce::ignoreUnused(ok);
-            
-            queueIndex = 0;
+            juce::FloatVectorOperations::copy(destination, source, numSamples);
+        }
+        else
+        {
+            for( int i = 0; i < numSamples; ++i )
+                destination[i] = static_cast<float>(source[i]);
         }
-        
-        bufferToFill.setSample(0, queueIndex, sample);
-        ++queueIndex;
     }
 };
 
@@ -151,14 +228,11 @@ enum Slope
 	S_12,
 	S_24,
 	S_36,
-	S_48
-};
-
-enum ChainPossition
-{
-	LowCut,
-	Peak,
-	HighCut
+	S_48,
+	S_60,
+	S_72,
+	S_84,
+	S_96
 };
 
 struct ChainSettings
@@ -170,44 +244,181 @@ struct ChainSettings
 
 ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
 
-using Filter = juce::dsp::IIR::Filter<float>;
+//Everything below is templated on the sample type, so the double precision path is native
+constexpr size_t maxCutSections = FilterDesign::maxButterworthOrder / 2;
+
+//Fixed storage for the sections of one cut filter, only the first (slope + 1) are in use
+template<typename SampleType>
+using CutCoefficients = std::array<BiquadCoefficients<SampleType>, maxCutSections>;
 
-using CutFilter = juce::dsp::ProcessorChain<Filter, Filter, Filter, Filter>;
+template<typename SampleType>
+void makePeakFilter(BiquadCoefficients<SampleType>& peak, const ChainSettings& chainSettings, double sampleRate);
+template<typename SampleType>
+void makeLowCutFilter(CutCoefficients<SampleType>& lowCut, const ChainSettings& chainSettings, double sampleRate);
+template<typename SampleType>
+void makeHighCutFilter(CutCoefficients<SampleType>& highCut, const ChainSettings& chainSettings, double sampleRate);
 
-using MonoChain = juce::dsp::ProcessorChain<CutFilter, Filter, CutFilter>;
+//Every coefficient the chain needs for one parameter snapshot, plain values so copying it never allocates
+template<typename SampleType>
+struct FilterCoefficientSet
+{
+	BiquadCoefficients<SampleType> peak{};
+	CutCoefficients<SampleType> lowCut{}, highCut{};
+
+	Slope lowCutSlope{ Slope::S_12 }, highCutSlope{ Slope::S_12 };
+};
 
-using Coefficients = Filter::CoefficientsPtr;
-void updateCoefficients(Coefficients& old, const Coefficients& replacements);
+template<typename SampleType>
+void makeFilterCoefficients(FilterCoefficientSet<SampleType>& set, const ChainSettings& chainSettings, double sampleRate);
 
-Coefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate);
+//The peak and high cut designed for the oversampled rate they run at, the low cut for the host rate
+template<typename SampleType>
+void makeFilterCoefficients(FilterCoefficientSet<SampleType>& set, const ChainSettings& chainSettings,
+	double sampleRate, double oversampledRate);
 
-template<int Index, typename ChainType, typename CoefficientType>
-void updateSlope(ChainType& chainType, const CoefficientType& coefficients);
+//Time for the slowest pole in use to ring down to the silence threshold
+template<typename SampleType>
+double getTailLengthSeconds(const FilterCoefficientSet<SampleType>& coefficients, double sampleRate, double oversampledRate);
 
-template<typename ChainType, typename CoefficientType>
-void updateCutFilter(ChainType& chain,
-	const CoefficientType& coefficients,
-	const Slope& slope);
+//Combined magnitude of the sections in use, the curve the linear phase kernel is sampled from
+template<typename SampleType>
+double getMagnitudeForFrequency(const FilterCoefficientSet<SampleType>& coefficients, double frequency, double sampleRate);
 
-inline auto makeLowCutFilter(const ChainSettings& chainSettings, double sampleRate)
+/*
+ The low cut, peak and high cut sections for every channel at once. The low cut stays at the host rate,
+ the peak and high cut share a second cascade so they can run oversampled where they cramp near Nyquist.
+ */
+template<typename SampleType>
+struct ChannelChain
 {
-	return juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(
-		chainSettings.lowCutFreq,
-		sampleRate,
-		(chainSettings.lowCutSlope + 1) * 2);
-}
+	BiquadCascade<SampleType, maxCutSections> lowCut;
+	BiquadCascade<SampleType, maxCutSections + 1> peakHighCut;
+	ChainOversampler<SampleType> oversampler;
+
+	//Silent samples sent through the oversampler since the cascade rang out, it holds back up to its latency of output
+	int oversamplerSilentSamples = 0;
+	bool oversamplerFlushed = false;
 
-inline auto makeHighCutFilter(const ChainSettings& chainSettings, double sampleRate)
+	void prepare(const juce::dsp::ProcessSpec& spec);
+
+	size_t getNumChannels() const { return lowCut.getNumChannels(); }
+};
+
+template<typename SampleType>
+void applyCoefficients(ChannelChain<SampleType>& chain, const FilterCoefficientSet<SampleType>& coefficients);
+template<typename SampleType>
+void applyCoefficients(ChannelChain<SampleType>& chain, const FilterCoefficientSet<SampleType>& coefficients, size_t channel);
+
+//How often coefficients are redesigned while a parameter is ramping
+enum UpdateGrid
+{
+	G_16,
+	G_32,
+	G_64,
+	G_PerBlock
+};
+
+//Number of samples between redesigns, 0 means once per host block
+int getUpdateGridSize(UpdateGrid grid);
+
+//Choice index is the power of two of the factor
+enum OversamplingFactor
+{
+	OS_Off,
+	OS_2x,
+	OS_4x,
+	OS_8x
+};
+
+enum OversamplingMode
+{
+	OM_MinimumPhase,
+	OM_LinearPhase
+};
+
+//The biquads, or a linear phase FIR sampled from their combined response
+enum FilterMode
+{
+	FM_IIR,
+	FM_LinearPhaseFIR
+};
+
+//ChainSettings with every continuous value ramped, slopes switch straight away
+struct SmoothedChainSettings
+{
+	void reset(double sampleRate, double rampLengthSeconds);
+
+	void setCurrentAndTargetSettings(const ChainSettings& chainSettings);
+	void setTargetSettings(const ChainSettings& chainSettings);
+
+	bool isSmoothing() const;
+
+	//Advances every ramp by numSamples and returns the settings reached
+	ChainSettings skip(int numSamples);
+
+	ChainSettings getCurrentSettings() const;
+
+private:
+	//Frequencies and Q ramp in the log domain, so a sweep sounds even across the range
+	using MultiplicativeValue = juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative>;
+
+	MultiplicativeValue peakFreq, peakQuality, lowCutFreq, highCutFreq;
+	juce::SmoothedValue<float> peakGainDecibels;
+
+	Slope lowCutSlope{ Slope::S_12 }, highCutSlope{ Slope::S_12 };
+};
+
+/*
+ Wait-free hand-off of the most recent value from one writer thread to one reader thread.
+ Uses three slots, so neither side ever waits for the other and stale values are simply overwritten.
+ */
+template<typename T>
+struct LatestValueExchange
 {
-	return juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(
-		chainSettings.highCutFreq,
-		sampleRate,
-		(chainSettings.highCutSlope + 1) * 2);
-}
+    //Only while neither side is running, every slot starts as a copy of the prototype
+    void reset(const T& prototype)
+    {
+        slots.fill(prototype);
+        shared = 1;
+        writeIndex = 0;
+        readIndex = 2;
+    }
+
+    //writer side
+    T& getWriteSlot() { return slots[(size_t)writeIndex]; }
+
+    void publish()
+    {
+        writeIndex = shared.exchange(writeIndex | newDataFlag) & indexMask;
+    }
+
+    //reader side, returns nullptr when nothing new has been published
+    T* acquire()
+    {
+        if( (shared.get() & newDataFlag) == 0 )
+            return nullptr;
+
+        readIndex = shared.exchange(readIndex) & indexMask;
+        return &slots[(size_t)readIndex];
+    }
+
+    //The value the reader acquired last
+    T& getReadSlot() { return slots[(size_t)readIndex]; }
+private:
+    static constexpr int indexMask = 3;
+    static constexpr int newDataFlag = 4;
+
+    std::array<T, 3> slots;
+    juce::Atomic<int> shared {1};
+    int writeIndex = 0;
+    int readIndex = 2;
+};
 //==============================================================================
 /**
 */
-class SoundWizardAudioProcessor : public juce::AudioProcessor
+class SoundWizardAudioProcessor : public juce::AudioProcessor,
+	juce::AudioProcessorParameter::Listener,
+	juce::AsyncUpdater
 #if JucePlugin_Enable_ARA
 	, public juce::AudioProcessorARAExtension
 #endif
@@ -226,6 +437,9 @@ public:
 #endif
 
 	void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+	void processBlock(juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+
+	bool supportsDoublePrecisionProcessing() const override { return true; }
 
 	//==============================================================================
 	juce::AudioProcessorEditor* createEditor() override;
@@ -253,20 +467,238 @@ public:
 	static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 	juce::AudioProcessorValueTreeState apvts {*this, nullptr, "Parameters", createParameterLayout()};
 
-    using BlockType = juce::AudioBuffer<float>;
-    SingleChannelSampleQueue<BlockType> leftChanelQueue {Channel::Left};
-    SingleChannelSampleQueue<BlockType> rightChanelQueue {Channel::Right};
+	//Channels follow the parameters unless they are unlinked, an unlinked channel keeps its own settings
+	static constexpr int maxChannels = 64;
+
+	void setChannelLinked(int channel, bool shouldBeLinked);
+	bool isChannelLinked(int channel) const;
+
+	void setUnlinkedChannelSettings(int channel, const ChainSettings& settings);
+	ChainSettings getUnlinkedChannelSettings(int channel) const;
+
+    SingleChannelSampleQueue leftChanelQueue {Channel::Left};
+    SingleChannelSampleQueue rightChanelQueue {Channel::Right};
+
+	//Written by the audio thread each block, read by the editor without locks
+	LoadMeter loadMeter;
+
+	//The designer's and the audio thread's halves of a parameter ramp, run on the calling thread so the benchmarks
+	//can time them apart. Only while the designer threads are stopped, as they are after releaseResources.
+	template<typename SampleType> void designRampNow();
+	template<typename SampleType> int pullRampNow();
+	template<typename SampleType> void applyRampStepNow(int index);
 private:
 
-	//Create a stereo using 2 mono channels
-	MonoChain leftChain, rightChain;
+	//Every channel runs through one chain, packed into the lanes of SIMD registers.
+	//Only the chain matching the host's processing precision is prepared.
+	ChannelChain<float> floatChain;
+	ChannelChain<double> doubleChain;
+
+	template<typename SampleType>
+	ChannelChain<SampleType>& getFilterChain()
+	{
+		if constexpr (std::is_same_v<SampleType, double>)
+			return doubleChain;
+		else
+			return floatChain;
+	}
+
+	struct ChannelLink
+	{
+		bool linked = true;
+		ChainSettings settings;
+	};
+
+	//Written under the lock by the message thread, the designer thread takes a copy when the version moves
+	std::array<ChannelLink, maxChannels> channelLinks;
+	juce::SpinLock channelLinkLock;
+	juce::Atomic<int> channelLinksVersion{ 0 };
+
+	juce::ValueTree createChannelLinksTree() const;
+	void restoreChannelLinks(const juce::ValueTree& tree);
+
+	//Bumped by the parameter listeners, the designer thread only reads the parameters when it moves
+	juce::Atomic<int> parametersVersion{ 0 };
+
+	/*
+	 Every coefficient set one parameter ramp needs, laid out ahead of time by the designer thread.
+	 Step k runs from startSample + k * gridSize and holds the settings reached at its end,
+	 the last one holds the target and runs until the next ramp arrives.
+	 */
+	template<typename SampleType>
+	struct CoefficientRamp
+	{
+		std::vector<FilterCoefficientSet<SampleType>> steps;
+		std::vector<double> stepTailSeconds;
+		int numSteps = 0;
+
+		//In host samples since prepareToPlay
+		juce::int64 startSample = 0;
+		int gridSize = 1;
+
+		//The rate the steps were designed for, the audio thread switches to it along with them
+		size_t oversamplingOrder = 0;
+		bool linearPhase = false;
+
+		//Unlinked channels keep one set of their own for the whole ramp
+		std::array<bool, maxChannels> linked{};
+		bool allChannelsLinked = true;
+		std::array<FilterCoefficientSet<SampleType>, maxChannels> unlinked;
+		double unlinkedTailSeconds = 0.0;
+
+		int getStepIndex(juce::int64 position) const
+		{
+			return (int)juce::jlimit<juce::int64>(0, numSteps - 1, (position - startSample) / gridSize);
+		}
+
+		//First sample of the next step, the last step has none
+		juce::int64 getStepEnd(int index) const { return startSample + (juce::int64)(index + 1) * gridSize; }
+	};
+
+	LatestValueExchange<CoefficientRamp<float>> floatRamps;
+	LatestValueExchange<CoefficientRamp<double>> doubleRamps;
+
+	template<typename SampleType>
+	LatestValueExchange<CoefficientRamp<SampleType>>& getRampExchange()
+	{
+		if constexpr (std::is_same_v<SampleType, double>)
+			return doubleRamps;
+		else
+			return floatRamps;
+	}
+
+	//Advanced by the audio thread after every block, the designer starts each ramp where it has got to
+	std::atomic<juce::int64> processedSamples{ 0 };
+	int activeRampStep = -1;
+
+	//Designer thread only, or prepareToPlay while it is stopped
+	static constexpr double smoothingTimeSeconds = 0.05;
+	SmoothedChainSettings rampSettings;
+	juce::int64 rampStartSample = 0;
+	int designedParametersVersion = -1, designedLinksVersion = -1;
+	double designSampleRate = 44100.0;
+	int designBlockSize = 0;
+	size_t designNumChannels = 0;
+	bool designDoublePrecision = false;
+
+	std::atomic<float>* updateGridParameter = nullptr;
+
+	//The oversampling the chain currently runs at, it changes along with the first ramp designed for another one
+	std::atomic<float>* oversamplingParameter = nullptr;
+	std::atomic<float>* oversamplingModeParameter = nullptr;
+	size_t activeOversamplingOrder = 0;
+	bool activeLinearPhase = false;
+
+	//Samples the curve into a new kernel whenever the parameters move, and rebuilds the convolver when its size does
+	struct KernelDesignThread : public juce::Thread
+	{
+		explicit KernelDesignThread(SoundWizardAudioProcessor& p) : juce::Thread("SoundWizard FIR Design"), processor(p) { }
+
+		void run() override;
+
+		SoundWizardAudioProcessor& processor;
+	};
+
+	static constexpr int kernelRetryIntervalMs = 5;
+
+	std::atomic<bool> kernelDesignPending{ false };
+
+	void requestKernelDesign();
+
+	//Lays out a new ramp whenever the parameters or the channel links move, sleeps otherwise
+	struct CoefficientDesignThread : public juce::Thread
+	{
+		explicit CoefficientDesignThread(SoundWizardAudioProcessor& p) : juce::Thread("SoundWizard Coefficient Design"), processor(p) { }
+
+		void run() override;
+
+		SoundWizardAudioProcessor& processor;
+	};
+
+	//Set until the designer wakes up, so the listeners signal it once however many parameters move
+	std::atomic<bool> designPending{ false };
+
+	void requestCoefficientDesign();
+
+	juce::AudioProcessorParameter* firLengthParameter = nullptr;
+	juce::AudioProcessorParameter* firPartitionParameter = nullptr;
+	std::atomic<float>* firLengthValue = nullptr;
+	std::atomic<float>* firPartitionValue = nullptr;
+
+	int getFirKernelOrder() const;
+	int getFirPartitionOrder() const;
+
+	/*
+	 A new kernel length or partition size is allocated into the convolver the audio thread is not using,
+	 which is handed over with its first kernel already in place. The audio thread swaps it in at the start
+	 of a block, the designer takes the other one for the next change once it has.
+	 */
+	std::array<LinearPhaseConvolver, 2> linearPhaseConvolvers;
+	std::atomic<int> pendingConvolver{ -1 };
+	int activeConvolver = 0;
+
+	LinearPhaseConvolver& getActiveConvolver() { return linearPhaseConvolvers[(size_t)activeConvolver]; }
+
+	//Designer thread only, or prepareToPlay while it is stopped
+	int kernelConvolver = 0;
+	std::vector<float> kernelMagnitudes;
+	double kernelSampleRate = 44100.0;
+	int kernelNumChannels = 0;
+
+	//The parameters the newest kernel was designed from, and those at the last switch to the FIR.
+	//The audio thread keeps the biquads running until a kernel designed after the switch is in place.
+	std::atomic<int> kernelVersion{ -1 };
+	std::atomic<int> filterModeVersion{ 0 };
+
+	std::atomic<float>* filterModeParameter = nullptr;
+	juce::RangedAudioParameter* filterModeChoiceParameter = nullptr;
+	FilterMode activeFilterMode = FM_IIR;
+
+	//Designer thread, false while every kernel slot is busy
+	bool updateLinearPhaseKernel(bool force);
+
+	//Audio thread, true when it swapped in a convolver of another size
+	bool adoptPendingConvolver();
+	template<typename SampleType> bool updateFilterMode(bool force);
+	template<typename SampleType> void updateLatency();
+
+	//The latency of whatever runs now. The audio thread works it out, the message thread tells the host
+	std::atomic<int> runningLatencySamples{ 0 };
+
+	void handleAsyncUpdate() override;
+
+	//Worst case of the main and the unlinked designs, read by the host from any thread
+	double linkedTailSeconds = 0.0, unlinkedTailSeconds = 0.0;
+	std::atomic<double> tailLengthSeconds{ 0.0 };
+
+	void updateTailLength();
+
+	//The largest window the analyzer reads, the editor's order8192
+	static constexpr int maxAnalyzerWindow = 1 << 13;
+
+	//The editor's peak hold falls 12 dB a second, from 12 dB over full scale it reaches the -48 dB floor in 5,
+	//by which time the slowest average has settled as well
+	static constexpr double analyzerDecaySeconds = 5.0;
+
+	//Silent samples the analyzer still takes, set in prepareToPlay for the host rate
+	int analyzerSilenceLimit = maxAnalyzerWindow;
+	int analyzerSilentSamples = 0;
+
+	void parameterValueChanged(int parameterIndex, float newValue) override;
+	void parameterGestureChanged(int parameterIndex, bool gestureIsStarting) override { }
 
-	void updatePeakFilter(const ChainSettings& chainSettings);
+	template<typename SampleType> void prepareFilters(const juce::dsp::ProcessSpec& spec);
+	template<typename SampleType> bool updateOversampling(size_t order, bool linearPhase, bool force);
+	template<typename SampleType> void processSamples(juce::AudioBuffer<SampleType>& buffer);
+	template<typename SampleType> void processFilters(juce::dsp::AudioBlock<SampleType>& block);
 
-	void updateLowCutFilters(const ChainSettings& chainSettings);
-	void updateHighCutFilters(const ChainSettings& chainSettings);
+	template<typename SampleType> void designCoefficientRamp(bool force);
+	template<typename SampleType> void pullCoefficientRamp(bool force);
+	template<typename SampleType> void applyRampStep(const CoefficientRamp<SampleType>& ramp, int index);
 
-	void updateFilters();
+	//Declared after everything they read
+	KernelDesignThread kernelDesignThread{ *this };
+	CoefficientDesignThread coefficientDesignThread{ *this };
 	//==============================================================================
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SoundWizardAudioProcessor)
 };
@@ -0,0 +1,166 @@
+/*
+  ==============================================================================
+
+	SoundWizard tests.
+
+	Runs every juce::UnitTest registered in this target and returns non-zero
+	when any of them failed, so a build script can gate on it.
+
+	SoundWizardTests
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../Source/PluginProcessor.h"
+
+namespace
+{
+	//The chain the processor ran before BiquadCascade, one instance per channel
+	template<typename SampleType>
+	using Filter = juce::dsp::IIR::Filter<SampleType>;
+
+	template<typename SampleType>
+	using CutFilter = juce::dsp::ProcessorChain<Filter<SampleType>, Filter<SampleType>, Filter<SampleType>, Filter<SampleType>,
+		Filter<SampleType>, Filter<SampleType>, Filter<SampleType>, Filter<SampleType>>;
+
+	template<typename SampleType>
+	using MonoChain = juce::dsp::ProcessorChain<CutFilter<SampleType>, Filter<SampleType>, CutFilter<SampleType>>;
+
+	template<typename SampleType>
+	typename Filter<SampleType>::CoefficientsPtr makeCoefficients(const BiquadCoefficients<SampleType>& c)
+	{
+		return new juce::dsp::IIR::Coefficients<SampleType>(c[0], c[1], c[2], SampleType(1), c[3], c[4]);
+	}
+
+	//Sections past the slope bypassed, the way the processor used to set them
+	template<typename SampleType, size_t... Index>
+	void setCutFilter(CutFilter<SampleType>& cut, const CutCoefficients<SampleType>& coefficients, Slope slope,
+		std::index_sequence<Index...>)
+	{
+		((cut.template get<(int)Index>().coefficients = makeCoefficients(coefficients[Index])), ...);
+		((cut.template setBypassed<(int)Index>((int)Index > slope)), ...);
+	}
+
+	template<typename SampleType>
+	void setMonoChain(MonoChain<SampleType>& chain, const FilterCoefficientSet<SampleType>& coefficients)
+	{
+		setCutFilter(chain.template get<0>(), coefficients.lowCut, coefficients.lowCutSlope, std::make_index_sequence<maxCutSections>());
+		chain.template get<1>().coefficients = makeCoefficients(coefficients.peak);
+		setCutFilter(chain.template get<2>(), coefficients.highCut, coefficients.highCutSlope, std::make_index_sequence<maxCutSections>());
+	}
+}
+
+//The multichannel cascade has to give exactly what the per channel ProcessorChains gave
+class BiquadCascadeTests : public juce::UnitTest
+{
+public:
+	BiquadCascadeTests() : juce::UnitTest("BiquadCascade", "DSP") { }
+
+	void runTest() override
+	{
+		runPrecision<float>("float");
+		runPrecision<double>("double");
+	}
+
+private:
+	static constexpr double sampleRate = 48000.0;
+	static constexpr int blockSize = 256;
+	static constexpr int numBlocks = 16;
+
+	template<typename SampleType>
+	void runPrecision(const juce::String& precision)
+	{
+		for (auto numChannels : { 1, 2, 8 })
+		{
+			beginTest(precision + ", " + juce::String(numChannels) + " channels");
+
+			for (int low = S_12; low <= S_96; ++low)
+				for (int high = S_12; high <= S_96; ++high)
+					expectEquals(countMismatches<SampleType>(numChannels, static_cast<Slope>(low), static_cast<Slope>(high)), 0,
+						"low cut " + juce::String(12 * (low + 1)) + " dB/oct, high cut " + juce::String(12 * (high + 1)) + " dB/oct");
+		}
+	}
+
+	//Samples where the two paths differ in any bit
+	template<typename SampleType>
+	int countMismatches(int numChannels, Slope lowCutSlope, Slope highCutSlope)
+	{
+		ChainSettings settings;
+		settings.lowCutFreq = 80.f;
+		settings.peakFreq = 1000.f;
+		settings.peakGainDecibels = 6.f;
+		settings.peakQuality = 0.7f;
+		settings.highCutFreq = 8000.f;
+		settings.lowCutSlope = lowCutSlope;
+		settings.highCutSlope = highCutSlope;
+
+		FilterCoefficientSet<SampleType> coefficients;
+		makeFilterCoefficients(coefficients, settings, sampleRate, sampleRate);
+
+		const juce::dsp::ProcessSpec spec{ sampleRate, (juce::uint32)blockSize, (juce::uint32)numChannels };
+
+		//What processFilters runs with oversampling off
+		ChannelChain<SampleType> cascade;
+		cascade.prepare(spec);
+		applyCoefficients(cascade, coefficients);
+
+		std::vector<MonoChain<SampleType>> reference((size_t)numChannels);
+
+		for (auto& chain : reference)
+		{
+			setMonoChain(chain, coefficients);
+			chain.prepare({ sampleRate, (juce::uint32)blockSize, 1 });
+		}
+
+		//Noise, different on every channel, so no lane can hide behind another
+		juce::AudioBuffer<SampleType> cascadeBuffer(numChannels, blockSize), referenceBuffer(numChannels, blockSize);
+		juce::Random random(getRandom().nextInt64());
+		auto mismatches = 0;
+
+		for (int b = 0; b < numBlocks; ++b)
+		{
+			for (int channel = 0; channel < numChannels; ++channel)
+				for (int i = 0; i < blockSize; ++i)
+					cascadeBuffer.setSample(channel, i, (SampleType)(random.nextFloat() - 0.5f));
+
+			referenceBuffer.makeCopyOf(cascadeBuffer);
+
+			juce::dsp::AudioBlock<SampleType> cascadeBlock(cascadeBuffer);
+			cascade.lowCut.process(juce::dsp::ProcessContextReplacing<SampleType>(cascadeBlock));
+			cascade.peakHighCut.process(juce::dsp::ProcessContextReplacing<SampleType>(cascadeBlock));
+
+			juce::dsp::AudioBlock<SampleType> referenceBlock(referenceBuffer);
+
+			for (size_t channel = 0; channel < (size_t)numChannels; ++channel)
+			{
+				auto channelBlock = referenceBlock.getSingleChannelBlock(channel);
+				reference[channel].process(juce::dsp::ProcessContextReplacing<SampleType>(channelBlock));
+			}
+
+			for (int channel = 0; channel < numChannels; ++channel)
+				for (int i = 0; i < blockSize; ++i)
+					if (cascadeBuffer.getSample(channel, i) != referenceBuffer.getSample(channel, i))
+						++mismatches;
+		}
+
+		return mismatches;
+	}
+};
+
+static BiquadCascadeTests biquadCascadeTests;
+
+int main(int argc, char* argv[])
+{
+	juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+	juce::UnitTestRunner runner;
+	runner.setAssertOnFailure(false);
+	runner.runAllTests();
+
+	for (int i = 0; i < runner.getNumResults(); ++i)
+		if (runner.getResult(i)->failures > 0)
+			return 1;
+
+	return 0;
+}